@@ -1,4 +1,27 @@
 set(WINDOW_WIDTH 1280)
 set(WINDOW_HEIGHT 720)
 
-set(MAX_FRAMES_IN_FLIGHT 2)
\ No newline at end of file
+set(MAX_FRAMES_IN_FLIGHT 2)
+
+set(PIPELINE_CACHE_FILE ${PROJECT_NAME}.pipeline_cache)
+
+set(HEADLESS_FRAME_COUNT 1000)
+
+set(GPU_PROFILER_HISTORY 240)
+
+set(TRACE_CAPACITY 262144)
+
+set(BENCHMARK_WARMUP_FRAMES 100)
+set(BENCHMARK_FRAMES 1000)
+
+set(MEMORY_BLOCK_SIZE 67108864)
+
+set(GRID_TRIANGLES 1000000)
+set(INSTANCE_COUNT 1000000)
+
+set(BINDLESS_IMAGE_CAPACITY 4096)
+set(BINDLESS_BUFFER_CAPACITY 4096)
+
+set(STAGING_RING_FRAME_SIZE 8388608)
+
+set(UNIFORM_RING_FRAME_SIZE 65536)
\ No newline at end of file
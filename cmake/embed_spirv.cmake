@@ -0,0 +1,30 @@
+# Turns a SPIR-V binary into a header with its words as a constexpr uint32_t array.
+# Usage: cmake -DINPUT=<file.spv> -DOUTPUT=<file.h> -DSYMBOL=<identifier> -P embed_spirv.cmake
+
+file(READ ${INPUT} SPIRV_HEX HEX)
+string(LENGTH "${SPIRV_HEX}" SPIRV_HEX_LENGTH)
+math(EXPR SPIRV_REMAINDER "${SPIRV_HEX_LENGTH} % 8")
+
+if(SPIRV_HEX_LENGTH EQUAL 0 OR NOT SPIRV_REMAINDER EQUAL 0)
+  message(FATAL_ERROR "${INPUT} isn't a whole number of SPIR-V words")
+endif()
+
+# glslc writes little-endian words, so each group of four bytes is reversed into one literal, eight literals per line.
+string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1, " SPIRV_WORDS "${SPIRV_HEX}")
+string(REPEAT "0x........, " 8 SPIRV_LINE)
+string(STRIP "${SPIRV_LINE}" SPIRV_LINE)
+string(REGEX REPLACE "(${SPIRV_LINE}) " "\\1\n    " SPIRV_WORDS "${SPIRV_WORDS}")
+string(STRIP "${SPIRV_WORDS}" SPIRV_WORDS)
+
+cmake_path(GET INPUT FILENAME INPUT_FILE_NAME)
+
+file(WRITE ${OUTPUT}
+"// Generated from ${INPUT_FILE_NAME} by cmake/embed_spirv.cmake, do not edit.
+#pragma once
+
+#include <cstdint>
+
+alignas(4) inline constexpr uint32_t ${SYMBOL}[] = {
+    ${SPIRV_WORDS}
+};
+")
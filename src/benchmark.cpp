@@ -0,0 +1,215 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#include <spdlog/spdlog.h>
+
+#include "statistics.h"
+
+const Benchmark::Metric Benchmark::METRICS[6] = {
+    {"frame_time_ms", &FrameSample::frame_time},
+    {"cpu_time_ms", &FrameSample::cpu_time},
+    {"fence_wait_ms", &FrameSample::fence_wait_time},
+    {"gpu_time_ms", &FrameSample::gpu_time},
+    {"drawn_instances", &FrameSample::drawn_instances},
+    {"culled_instances", &FrameSample::culled_instances},
+};
+
+// Quoted and escaped, since device names are free text. Control characters JSON has no short escape for are written
+// as \u00XX.
+static void write_json_string(std::ofstream &file, const std::string &value)
+{
+    file << '"';
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+            file << '\\' << c;
+        else if (c == '\n')
+            file << "\\n";
+        else if (c == '\r')
+            file << "\\r";
+        else if (c == '\t')
+            file << "\\t";
+        else if (static_cast<unsigned char>(c) < 0x20)
+            file << fmt::format("\\u{:04x}", static_cast<unsigned char>(c));
+        else
+            file << c;
+    }
+    file << '"';
+}
+
+Benchmark::Benchmark(uint32_t warmup_frames, uint32_t measured_frames) : m_warmup_frames(warmup_frames), m_measured_frames(measured_frames)
+{
+    m_samples.reserve(measured_frames);
+}
+
+void Benchmark::set_property(const std::string &name, const std::string &value)
+{
+    m_properties.emplace_back(name, value);
+}
+
+void Benchmark::begin_frame()
+{
+    m_frame_start = std::chrono::steady_clock::now();
+    m_frame_fence_wait = 0.0;
+}
+
+void Benchmark::add_fence_wait(double duration)
+{
+    m_frame_fence_wait += duration;
+}
+
+void Benchmark::end_frame()
+{
+    std::chrono::duration<double, std::milli> frame_time = std::chrono::steady_clock::now() - m_frame_start;
+
+    if (current_frame() >= 0)
+    {
+        FrameSample sample;
+        sample.frame_time = frame_time.count();
+        sample.cpu_time = std::max(frame_time.count() - m_frame_fence_wait, 0.0);
+        sample.fence_wait_time = m_frame_fence_wait;
+        m_samples.push_back(sample);
+    }
+
+    m_frame_count++;
+
+    if (m_frame_count == m_warmup_frames)
+        SPDLOG_INFO("Benchmark warmup done ({} frames), measuring {} frames", m_warmup_frames, m_measured_frames);
+}
+
+int64_t Benchmark::current_frame() const
+{
+    if (m_frame_count < m_warmup_frames || is_finished())
+        return -1;
+
+    return static_cast<int64_t>(m_frame_count - m_warmup_frames);
+}
+
+void Benchmark::record_gpu_time(int64_t frame, double duration)
+{
+    if (frame >= 0 && frame < static_cast<int64_t>(m_samples.size()))
+        m_samples[frame].gpu_time = duration;
+}
+
+void Benchmark::record_culling(int64_t frame, uint32_t drawn, uint32_t culled)
+{
+    if (frame >= 0 && frame < static_cast<int64_t>(m_samples.size()))
+    {
+        m_samples[frame].drawn_instances = drawn;
+        m_samples[frame].culled_instances = culled;
+    }
+}
+
+void Benchmark::log_summary() const
+{
+    SPDLOG_INFO("Benchmark results over {} frames:", m_samples.size());
+
+    for (const auto &metric : METRICS)
+    {
+        Statistics statistics = compute_statistics(collect(metric.value));
+
+        if (statistics.count == 0)
+            continue;
+
+        SPDLOG_INFO("\t{:<14} mean {:.3f}, median {:.3f}, p95 {:.3f}, p99 {:.3f}, stddev {:.3f}",
+                    metric.name, statistics.mean, statistics.median, statistics.p95, statistics.p99, statistics.stddev);
+    }
+}
+
+void Benchmark::write_report(const std::string &path) const
+{
+    if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0)
+        write_csv(path);
+    else
+        write_json(path);
+}
+
+std::vector<double> Benchmark::collect(double FrameSample::*value) const
+{
+    std::vector<double> values;
+    values.reserve(m_samples.size());
+
+    // GPU results are negative for frames that never got them back, those are left out rather than counted as zero.
+    for (const auto &sample : m_samples)
+        if (sample.*value >= 0.0)
+            values.push_back(sample.*value);
+
+    return values;
+}
+
+void Benchmark::write_json(const std::string &path) const
+{
+    std::ofstream file(path, std::ios::trunc);
+
+    if (!file.is_open())
+    {
+        SPDLOG_ERROR("Couldn't open benchmark report for writing: {}", path);
+        return;
+    }
+
+    file << "{\n  \"warmup_frames\": " << m_warmup_frames << ",\n  \"measured_frames\": " << m_samples.size() << ",\n  \"properties\": {";
+
+    for (auto i = 0; i < m_properties.size(); i++)
+    {
+        file << (i ? ", " : "");
+        write_json_string(file, m_properties[i].first);
+        file << ": ";
+        write_json_string(file, m_properties[i].second);
+    }
+
+    file << "},\n  \"metrics\": {";
+
+    for (auto i = 0; i < std::size(METRICS); i++)
+    {
+        Statistics statistics = compute_statistics(collect(METRICS[i].value));
+
+        file << (i ? "," : "") << "\n    \"" << METRICS[i].name << "\": "
+             << fmt::format("{{\"count\": {}, \"mean\": {:.6f}, \"median\": {:.6f}, \"p95\": {:.6f}, \"p99\": {:.6f}, \"stddev\": {:.6f}, \"min\": {:.6f}, \"max\": {:.6f}}}",
+                            statistics.count, statistics.mean, statistics.median, statistics.p95, statistics.p99, statistics.stddev, statistics.min, statistics.max);
+    }
+
+    file << "\n  },\n  \"frames\": {";
+
+    for (auto i = 0; i < std::size(METRICS); i++)
+    {
+        file << (i ? "," : "") << "\n    \"" << METRICS[i].name << "\": [";
+
+        for (auto j = 0; j < m_samples.size(); j++)
+        {
+            double value = m_samples[j].*METRICS[i].value;
+            file << (j ? ", " : "") << (value >= 0.0 ? fmt::format("{:.6f}", value) : "null");
+        }
+
+        file << ']';
+    }
+
+    file << "\n  }\n}\n";
+
+    SPDLOG_INFO("Benchmark report written: {}", path);
+}
+
+void Benchmark::write_csv(const std::string &path) const
+{
+    std::ofstream file(path, std::ios::trunc);
+
+    if (!file.is_open())
+    {
+        SPDLOG_ERROR("Couldn't open benchmark report for writing: {}", path);
+        return;
+    }
+
+    file << "metric,count,mean,median,p95,p99,stddev,min,max\n";
+
+    for (const auto &metric : METRICS)
+    {
+        Statistics statistics = compute_statistics(collect(metric.value));
+
+        file << fmt::format("{},{},{:.6f},{:.6f},{:.6f},{:.6f},{:.6f},{:.6f},{:.6f}\n",
+                            metric.name, statistics.count, statistics.mean, statistics.median, statistics.p95, statistics.p99, statistics.stddev, statistics.min, statistics.max);
+    }
+
+    SPDLOG_INFO("Benchmark report written: {}", path);
+}
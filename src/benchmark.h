@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Fixed-length frame recorder: a number of warmup frames that are thrown away, then a number of measured frames whose
+// timings end up in the report.
+class Benchmark
+{
+public:
+    Benchmark(uint32_t warmup_frames, uint32_t measured_frames);
+
+    void set_property(const std::string &name, const std::string &value);
+
+    void begin_frame();
+    void add_fence_wait(double duration);
+    void end_frame();
+
+    // Index of the frame being recorded, or -1 while warming up. GPU times arrive a few frames late, so the caller
+    // remembers this at submission and hands it back once the timestamps are resolved.
+    int64_t current_frame() const;
+    void record_gpu_time(int64_t frame, double duration);
+    void record_culling(int64_t frame, uint32_t drawn, uint32_t culled);
+
+    bool is_finished() const { return m_frame_count >= m_warmup_frames + m_measured_frames; }
+
+    void log_summary() const;
+    void write_report(const std::string &path) const;
+
+private:
+    struct FrameSample
+    {
+        double frame_time = 0.0;
+        double cpu_time = 0.0;
+        double fence_wait_time = 0.0;
+        double gpu_time = -1.0;
+        double drawn_instances = -1.0;
+        double culled_instances = -1.0;
+    };
+
+    struct Metric
+    {
+        const char *name;
+        double FrameSample::*value;
+    };
+
+    static const Metric METRICS[6];
+
+    std::vector<double> collect(double FrameSample::*value) const;
+
+    void write_json(const std::string &path) const;
+    void write_csv(const std::string &path) const;
+
+    uint32_t m_warmup_frames;
+    uint32_t m_measured_frames;
+    uint32_t m_frame_count = 0;
+    std::chrono::steady_clock::time_point m_frame_start;
+    double m_frame_fence_wait = 0.0;
+    std::vector<FrameSample> m_samples;
+    std::vector<std::pair<std::string, std::string>> m_properties;
+};
@@ -0,0 +1,202 @@
+#include "bindless.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+bool BindlessHeap::is_supported(const VkPhysicalDeviceVulkan12Features &features)
+{
+    return features.runtimeDescriptorArray && features.descriptorBindingPartiallyBound && features.descriptorBindingUpdateUnusedWhilePending &&
+           features.descriptorBindingSampledImageUpdateAfterBind && features.descriptorBindingStorageBufferUpdateAfterBind &&
+           features.shaderSampledImageArrayNonUniformIndexing;
+}
+
+void BindlessHeap::enable_features(VkPhysicalDeviceVulkan12Features &features)
+{
+    features.runtimeDescriptorArray = VK_TRUE;
+    features.descriptorBindingPartiallyBound = VK_TRUE;
+    features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+}
+
+void BindlessHeap::create(VkPhysicalDevice physical_device, VkDevice device, uint32_t image_capacity, uint32_t buffer_capacity)
+{
+    m_device = device;
+
+    VkPhysicalDeviceVulkan12Properties vulkan12_properties{};
+    vulkan12_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &vulkan12_properties;
+
+    vkGetPhysicalDeviceProperties2(physical_device, &properties);
+
+    // Combined image samplers count against both the sampler and the sampled image limits.
+    image_capacity = std::min({image_capacity,
+                               vulkan12_properties.maxPerStageDescriptorUpdateAfterBindSamplers,
+                               vulkan12_properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                               vulkan12_properties.maxDescriptorSetUpdateAfterBindSamplers,
+                               vulkan12_properties.maxDescriptorSetUpdateAfterBindSampledImages});
+    buffer_capacity = std::min({buffer_capacity,
+                                vulkan12_properties.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+                                vulkan12_properties.maxDescriptorSetUpdateAfterBindStorageBuffers});
+
+    m_image_slots = {image_capacity};
+    m_buffer_slots = {buffer_capacity};
+
+    VkDescriptorSetLayoutBinding bindings[2]{};
+    bindings[SAMPLED_IMAGE_BINDING].binding = SAMPLED_IMAGE_BINDING;
+    bindings[SAMPLED_IMAGE_BINDING].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[SAMPLED_IMAGE_BINDING].descriptorCount = image_capacity;
+    bindings[SAMPLED_IMAGE_BINDING].stageFlags = VK_SHADER_STAGE_ALL;
+
+    bindings[STORAGE_BUFFER_BINDING].binding = STORAGE_BUFFER_BINDING;
+    bindings[STORAGE_BUFFER_BINDING].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[STORAGE_BUFFER_BINDING].descriptorCount = buffer_capacity;
+    bindings[STORAGE_BUFFER_BINDING].stageFlags = VK_SHADER_STAGE_ALL;
+
+    // Slots that were never registered are left unwritten, and new ones are written while earlier frames still use the set.
+    const VkDescriptorBindingFlags binding_flags[2] = {
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT,
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT,
+    };
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_create_info{};
+    binding_flags_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    binding_flags_create_info.bindingCount = 2;
+    binding_flags_create_info.pBindingFlags = binding_flags;
+
+    VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info{};
+    descriptor_set_layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    descriptor_set_layout_create_info.pNext = &binding_flags_create_info;
+    descriptor_set_layout_create_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    descriptor_set_layout_create_info.bindingCount = 2;
+    descriptor_set_layout_create_info.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(m_device, &descriptor_set_layout_create_info, nullptr, &m_set_layout) != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_CREATE_DESCRIPTOR_SET_LAYOUT_FAILURE");
+
+    VkDescriptorPoolSize pool_sizes[2]{};
+    pool_sizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    pool_sizes[0].descriptorCount = image_capacity;
+    pool_sizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    pool_sizes[1].descriptorCount = buffer_capacity;
+
+    VkDescriptorPoolCreateInfo descriptor_pool_create_info{};
+    descriptor_pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptor_pool_create_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    descriptor_pool_create_info.maxSets = 1;
+    descriptor_pool_create_info.poolSizeCount = 2;
+    descriptor_pool_create_info.pPoolSizes = pool_sizes;
+
+    if (vkCreateDescriptorPool(m_device, &descriptor_pool_create_info, nullptr, &m_descriptor_pool) != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_CREATE_DESCRIPTOR_POOL_FAILURE");
+
+    VkDescriptorSetAllocateInfo descriptor_set_allocate_info{};
+    descriptor_set_allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    descriptor_set_allocate_info.descriptorPool = m_descriptor_pool;
+    descriptor_set_allocate_info.descriptorSetCount = 1;
+    descriptor_set_allocate_info.pSetLayouts = &m_set_layout;
+
+    if (vkAllocateDescriptorSets(m_device, &descriptor_set_allocate_info, &m_descriptor_set) != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_ALLOCATE_DESCRIPTOR_SETS_FAILURE");
+
+    SPDLOG_INFO("Bindless heap: {} image slots, {} buffer slots", image_capacity, buffer_capacity);
+}
+
+void BindlessHeap::destroy()
+{
+    if (m_device == VK_NULL_HANDLE)
+        return;
+
+    vkDestroyDescriptorPool(m_device, m_descriptor_pool, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_set_layout, nullptr);
+    m_device = VK_NULL_HANDLE;
+}
+
+uint32_t BindlessHeap::register_image(VkImageView image_view, VkSampler sampler)
+{
+    const uint32_t slot = m_image_slots.allocate("image");
+
+    VkDescriptorImageInfo image_info{};
+    image_info.sampler = sampler;
+    image_info.imageView = image_view;
+    image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkWriteDescriptorSet descriptor_write{};
+    descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptor_write.dstSet = m_descriptor_set;
+    descriptor_write.dstBinding = SAMPLED_IMAGE_BINDING;
+    descriptor_write.dstArrayElement = slot;
+    descriptor_write.descriptorCount = 1;
+    descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptor_write.pImageInfo = &image_info;
+
+    vkUpdateDescriptorSets(m_device, 1, &descriptor_write, 0, nullptr);
+
+    return slot;
+}
+
+uint32_t BindlessHeap::register_buffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    const uint32_t slot = m_buffer_slots.allocate("buffer");
+
+    VkDescriptorBufferInfo buffer_info{buffer, offset, range};
+
+    VkWriteDescriptorSet descriptor_write{};
+    descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptor_write.dstSet = m_descriptor_set;
+    descriptor_write.dstBinding = STORAGE_BUFFER_BINDING;
+    descriptor_write.dstArrayElement = slot;
+    descriptor_write.descriptorCount = 1;
+    descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptor_write.pBufferInfo = &buffer_info;
+
+    vkUpdateDescriptorSets(m_device, 1, &descriptor_write, 0, nullptr);
+
+    return slot;
+}
+
+// The stale descriptor stays in place, partially bound arrays only require that shaders never read it again.
+void BindlessHeap::release_image(uint32_t slot)
+{
+    m_image_slots.release(slot);
+}
+
+void BindlessHeap::release_buffer(uint32_t slot)
+{
+    m_buffer_slots.release(slot);
+}
+
+void BindlessHeap::bind(VkCommandBuffer command_buffer, VkPipelineBindPoint bind_point, VkPipelineLayout pipeline_layout) const
+{
+    vkCmdBindDescriptorSets(command_buffer, bind_point, pipeline_layout, 0, 1, &m_descriptor_set, 0, nullptr);
+}
+
+uint32_t BindlessHeap::SlotAllocator::allocate(const char *kind)
+{
+    if (!free_slots.empty())
+    {
+        const uint32_t slot = free_slots.back();
+        free_slots.pop_back();
+
+        return slot;
+    }
+
+    if (next == capacity)
+    {
+        SPDLOG_ERROR("Bindless heap is out of {} slots ({} in use)", kind, capacity);
+        throw std::runtime_error("BINDLESS_HEAP_EXHAUSTED");
+    }
+
+    return next++;
+}
+
+void BindlessHeap::SlotAllocator::release(uint32_t slot)
+{
+    free_slots.push_back(slot);
+}
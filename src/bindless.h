@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+// A single descriptor set holding every sampled image and storage buffer the shaders can reach, as two large partially
+// bound arrays. Resources are registered into a slot and shaders index the array with it, so switching resources
+// between draws is a push constant change instead of a descriptor set bind. The set is update-after-bind, registering
+// while frames that use it are in flight is fine, but those frames may still read a slot that gets released, so
+// releases belong in deferred deletion.
+class BindlessHeap
+{
+public:
+    static constexpr uint32_t SAMPLED_IMAGE_BINDING = 0;
+    static constexpr uint32_t STORAGE_BUFFER_BINDING = 1;
+
+    // Descriptor indexing features the heap relies on.
+    static bool is_supported(const VkPhysicalDeviceVulkan12Features &features);
+    static void enable_features(VkPhysicalDeviceVulkan12Features &features);
+
+    // Capacities are clamped to the device's update-after-bind limits.
+    void create(VkPhysicalDevice physical_device, VkDevice device, uint32_t image_capacity, uint32_t buffer_capacity);
+    void destroy();
+
+    uint32_t register_image(VkImageView image_view, VkSampler sampler);
+    uint32_t register_buffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+    void release_image(uint32_t slot);
+    void release_buffer(uint32_t slot);
+
+    void bind(VkCommandBuffer command_buffer, VkPipelineBindPoint bind_point, VkPipelineLayout pipeline_layout) const;
+
+    VkDescriptorSetLayout set_layout() const { return m_set_layout; }
+
+private:
+    // Released slots are handed out again first, most recent first, before any slot that was never used.
+    struct SlotAllocator
+    {
+        uint32_t capacity = 0;
+        uint32_t next = 0;
+        std::vector<uint32_t> free_slots;
+
+        uint32_t allocate(const char *kind);
+        void release(uint32_t slot);
+    };
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_set_layout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptor_pool = VK_NULL_HANDLE;
+    VkDescriptorSet m_descriptor_set = VK_NULL_HANDLE;
+
+    SlotAllocator m_image_slots;
+    SlotAllocator m_buffer_slots;
+};
@@ -0,0 +1,227 @@
+#include "descriptor_allocator.h"
+
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+// Sets a single pool holds before the next one in a chain is created.
+static constexpr uint32_t POOL_SET_COUNT = 64;
+
+static VkDescriptorPool create_pool(VkDevice device)
+{
+    // Room for a few descriptors of every type the renderer binds outside the bindless heap.
+    const VkDescriptorPoolSize pool_sizes[] = {
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, POOL_SET_COUNT * 4},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, POOL_SET_COUNT},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, POOL_SET_COUNT},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, POOL_SET_COUNT},
+    };
+
+    VkDescriptorPoolCreateInfo descriptor_pool_create_info{};
+    descriptor_pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptor_pool_create_info.maxSets = POOL_SET_COUNT;
+    descriptor_pool_create_info.poolSizeCount = static_cast<uint32_t>(std::size(pool_sizes));
+    descriptor_pool_create_info.pPoolSizes = pool_sizes;
+
+    VkDescriptorPool pool;
+    if (vkCreateDescriptorPool(device, &descriptor_pool_create_info, nullptr, &pool) != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_CREATE_DESCRIPTOR_POOL_FAILURE");
+
+    return pool;
+}
+
+// VK_NULL_HANDLE when the pool is full and the caller should move on to the next one.
+static VkDescriptorSet try_allocate(VkDevice device, VkDescriptorPool pool, VkDescriptorSetLayout layout)
+{
+    VkDescriptorSetAllocateInfo descriptor_set_allocate_info{};
+    descriptor_set_allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    descriptor_set_allocate_info.descriptorPool = pool;
+    descriptor_set_allocate_info.descriptorSetCount = 1;
+    descriptor_set_allocate_info.pSetLayouts = &layout;
+
+    VkDescriptorSet descriptor_set;
+    VkResult result = vkAllocateDescriptorSets(device, &descriptor_set_allocate_info, &descriptor_set);
+
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+        return VK_NULL_HANDLE;
+
+    if (result != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_ALLOCATE_DESCRIPTOR_SETS_FAILURE");
+
+    return descriptor_set;
+}
+
+static void write_bindings(VkDevice device, VkDescriptorSet descriptor_set, const std::vector<DescriptorBinding> &bindings)
+{
+    std::vector<VkDescriptorBufferInfo> buffer_infos(bindings.size());
+    std::vector<VkDescriptorImageInfo> image_infos(bindings.size());
+    std::vector<VkWriteDescriptorSet> descriptor_writes(bindings.size());
+
+    for (size_t i = 0; i < bindings.size(); i++)
+    {
+        const DescriptorBinding &binding = bindings[i];
+
+        VkWriteDescriptorSet &descriptor_write = descriptor_writes[i];
+        descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptor_write.dstSet = descriptor_set;
+        descriptor_write.dstBinding = binding.binding;
+        descriptor_write.descriptorCount = 1;
+        descriptor_write.descriptorType = binding.type;
+
+        if (binding.buffer != VK_NULL_HANDLE)
+        {
+            buffer_infos[i] = {binding.buffer, binding.offset, binding.range};
+            descriptor_write.pBufferInfo = &buffer_infos[i];
+        }
+        else
+        {
+            image_infos[i] = {binding.sampler, binding.image_view, binding.image_layout};
+            descriptor_write.pImageInfo = &image_infos[i];
+        }
+    }
+
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptor_writes.size()), descriptor_writes.data(), 0, nullptr);
+}
+
+bool DescriptorBinding::operator==(const DescriptorBinding &other) const
+{
+    return binding == other.binding && type == other.type && buffer == other.buffer && offset == other.offset && range == other.range &&
+           image_view == other.image_view && sampler == other.sampler && image_layout == other.image_layout;
+}
+
+void FrameDescriptorAllocator::create(VkDevice device, uint32_t frame_count)
+{
+    m_device = device;
+    m_frames.resize(frame_count);
+
+    for (auto &frame : m_frames)
+        frame.pools.push_back(create_pool(m_device));
+}
+
+void FrameDescriptorAllocator::destroy()
+{
+    if (m_device == VK_NULL_HANDLE)
+        return;
+
+    for (auto &frame : m_frames)
+        for (auto pool : frame.pools)
+            vkDestroyDescriptorPool(m_device, pool, nullptr);
+
+    m_frames.clear();
+    m_device = VK_NULL_HANDLE;
+}
+
+void FrameDescriptorAllocator::begin_frame(uint32_t frame)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_frame = frame;
+
+    Frame &current = m_frames[m_frame];
+    for (size_t i = 0; i <= current.current; i++)
+        vkResetDescriptorPool(m_device, current.pools[i], 0);
+
+    current.current = 0;
+}
+
+VkDescriptorSet FrameDescriptorAllocator::allocate(VkDescriptorSetLayout layout, const std::vector<DescriptorBinding> &bindings)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Frame &frame = m_frames[m_frame];
+
+    VkDescriptorSet descriptor_set = try_allocate(m_device, frame.pools[frame.current], layout);
+    if (descriptor_set == VK_NULL_HANDLE)
+    {
+        // Pools past current were reset along with it, so the chain only grows once every one of them is full.
+        if (++frame.current == frame.pools.size())
+        {
+            frame.pools.push_back(create_pool(m_device));
+            SPDLOG_DEBUG("Frame {} descriptor pools grown to {}", m_frame, frame.pools.size());
+        }
+
+        descriptor_set = try_allocate(m_device, frame.pools[frame.current], layout);
+
+        if (descriptor_set == VK_NULL_HANDLE)
+            throw std::runtime_error("DESCRIPTOR_SET_TOO_LARGE");
+    }
+
+    write_bindings(m_device, descriptor_set, bindings);
+
+    return descriptor_set;
+}
+
+void DescriptorSetCache::create(VkDevice device)
+{
+    m_device = device;
+    m_pools.push_back(create_pool(m_device));
+}
+
+void DescriptorSetCache::destroy()
+{
+    if (m_device == VK_NULL_HANDLE)
+        return;
+
+    SPDLOG_INFO("Descriptor set cache: {} sets, {} lookups hit", m_sets.size(), m_hits);
+
+    for (auto pool : m_pools)
+        vkDestroyDescriptorPool(m_device, pool, nullptr);
+
+    m_pools.clear();
+    m_sets.clear();
+    m_device = VK_NULL_HANDLE;
+}
+
+VkDescriptorSet DescriptorSetCache::get(VkDescriptorSetLayout layout, const std::vector<DescriptorBinding> &bindings)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Key key{layout, bindings};
+
+    auto it = m_sets.find(key);
+    if (it != m_sets.end())
+    {
+        m_hits++;
+        return it->second;
+    }
+
+    VkDescriptorSet descriptor_set = try_allocate(m_device, m_pools.back(), layout);
+    if (descriptor_set == VK_NULL_HANDLE)
+    {
+        m_pools.push_back(create_pool(m_device));
+        descriptor_set = try_allocate(m_device, m_pools.back(), layout);
+
+        if (descriptor_set == VK_NULL_HANDLE)
+            throw std::runtime_error("DESCRIPTOR_SET_TOO_LARGE");
+    }
+
+    write_bindings(m_device, descriptor_set, bindings);
+    m_sets.emplace(std::move(key), descriptor_set);
+
+    return descriptor_set;
+}
+
+size_t DescriptorSetCache::KeyHash::operator()(const Key &key) const
+{
+    size_t seed = std::hash<VkDescriptorSetLayout>()(key.layout);
+
+    auto combine = [&seed](size_t value)
+    { seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2); };
+
+    for (const auto &binding : key.bindings)
+    {
+        combine(binding.binding);
+        combine(binding.type);
+        combine(std::hash<VkBuffer>()(binding.buffer));
+        combine(binding.offset);
+        combine(binding.range);
+        combine(std::hash<VkImageView>()(binding.image_view));
+        combine(std::hash<VkSampler>()(binding.sampler));
+        combine(binding.image_layout);
+    }
+
+    return seed;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+// One descriptor of a set, either a buffer range or an image with its sampler.
+struct DescriptorBinding
+{
+    uint32_t binding = 0;
+    VkDescriptorType type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize range = VK_WHOLE_SIZE;
+    VkImageView image_view = VK_NULL_HANDLE;
+    VkSampler sampler = VK_NULL_HANDLE;
+    VkImageLayout image_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    bool operator==(const DescriptorBinding &other) const;
+};
+
+// Transient descriptor sets that live for a single frame. Each frame in flight owns a chain of pools that grows whenever
+// the newest one runs out, sets are never freed one by one and instead the whole chain is reset when the frame comes
+// around again. Pools are kept across resets, so after the first few frames allocating is just vkAllocateDescriptorSets.
+class FrameDescriptorAllocator
+{
+public:
+    void create(VkDevice device, uint32_t frame_count);
+    void destroy();
+
+    // Resets every pool the frame allocated from, its previous submission must have completed.
+    void begin_frame(uint32_t frame);
+
+    // Allocates from the frame begun last and writes the bindings, the set is valid until that frame begins again.
+    VkDescriptorSet allocate(VkDescriptorSetLayout layout, const std::vector<DescriptorBinding> &bindings);
+
+private:
+    struct Frame
+    {
+        std::vector<VkDescriptorPool> pools;
+        size_t current = 0;
+    };
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    std::vector<Frame> m_frames;
+    uint32_t m_frame = 0;
+    std::mutex m_mutex;
+};
+
+// Persistent descriptor sets looked up by their layout and bindings. The first request for a combination allocates and
+// writes a set, every later one returns it untouched. Sets live as long as the cache, so only resources that do too
+// belong in it.
+class DescriptorSetCache
+{
+public:
+    void create(VkDevice device);
+    void destroy();
+
+    VkDescriptorSet get(VkDescriptorSetLayout layout, const std::vector<DescriptorBinding> &bindings);
+
+private:
+    struct Key
+    {
+        VkDescriptorSetLayout layout;
+        std::vector<DescriptorBinding> bindings;
+
+        bool operator==(const Key &other) const { return layout == other.layout && bindings == other.bindings; }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const;
+    };
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    std::vector<VkDescriptorPool> m_pools;
+    std::unordered_map<Key, VkDescriptorSet, KeyHash> m_sets;
+    uint64_t m_hits = 0;
+    std::mutex m_mutex;
+};
@@ -0,0 +1,172 @@
+#include "gpu_profiler.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "HelloVulkan_config.h"
+#include "trace.h"
+
+void GpuProfiler::create(VkPhysicalDevice physical_device, VkDevice device, uint32_t queue_family_index, uint32_t slot_count)
+{
+    m_device = device;
+
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(physical_device, &device_properties);
+
+    uint32_t queue_family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_count, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_count, queue_families.data());
+
+    uint32_t timestamp_valid_bits = queue_families[queue_family_index].timestampValidBits;
+
+    if (timestamp_valid_bits == 0 || device_properties.limits.timestampPeriod == 0.0f)
+    {
+        SPDLOG_WARN("Timestamp queries aren't supported on this queue, GPU profiling disabled");
+        return;
+    }
+
+    m_timestamp_period = device_properties.limits.timestampPeriod;
+    m_timestamp_mask = timestamp_valid_bits >= 64 ? ~0ull : (1ull << timestamp_valid_bits) - 1;
+
+    create_query_pool(slot_count);
+}
+
+void GpuProfiler::destroy()
+{
+    if (m_query_pool != VK_NULL_HANDLE)
+        vkDestroyQueryPool(m_device, m_query_pool, nullptr);
+
+    m_query_pool = VK_NULL_HANDLE;
+}
+
+uint32_t GpuProfiler::register_zone(const std::string &name)
+{
+    if (m_zones.size() == MAX_ZONES)
+        throw std::runtime_error("GPU_PROFILER_TOO_MANY_ZONES");
+
+    Zone zone;
+    zone.name = name;
+    zone.history.reserve(GPU_PROFILER_HISTORY);
+    m_zones.push_back(zone);
+
+    return static_cast<uint32_t>(m_zones.size() - 1);
+}
+
+void GpuProfiler::begin_slot(VkCommandBuffer command_buffer, uint32_t slot)
+{
+    if (!is_enabled())
+        return;
+
+    vkCmdResetQueryPool(command_buffer, m_query_pool, query_index(slot, 0), MAX_ZONES * 2);
+}
+
+void GpuProfiler::begin_zone(VkCommandBuffer command_buffer, uint32_t slot, uint32_t zone)
+{
+    if (!is_enabled())
+        return;
+
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_query_pool, query_index(slot, zone));
+}
+
+void GpuProfiler::end_zone(VkCommandBuffer command_buffer, uint32_t slot, uint32_t zone)
+{
+    if (!is_enabled())
+        return;
+
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_query_pool, query_index(slot, zone) + 1);
+}
+
+void GpuProfiler::set_slot_submit_time(uint32_t slot, uint64_t trace_time)
+{
+    if (is_enabled())
+        m_slot_submit_times[slot] = trace_time;
+}
+
+void GpuProfiler::resolve(uint32_t slot)
+{
+    if (!is_enabled() || m_zones.empty())
+        return;
+
+    // Value and availability for the begin and end query of every zone.
+    std::vector<uint64_t> results(m_zones.size() * 4);
+
+    VkResult result = vkGetQueryPoolResults(m_device, m_query_pool, query_index(slot, 0), static_cast<uint32_t>(m_zones.size() * 2),
+                                            results.size() * sizeof(uint64_t), results.data(), 2 * sizeof(uint64_t),
+                                            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    // Not ready only means some zones weren't written in this slot, the available ones are still valid.
+    if (result != VK_SUCCESS && result != VK_NOT_READY)
+        return;
+
+    uint64_t first_timestamp = UINT64_MAX;
+    for (auto i = 0; i < m_zones.size(); i++)
+        if (results[i * 4 + 1])
+            first_timestamp = std::min(first_timestamp, results[i * 4] & m_timestamp_mask);
+
+    for (auto i = 0; i < m_zones.size(); i++)
+    {
+        const uint64_t *begin = &results[i * 4];
+        const uint64_t *end = &results[i * 4 + 2];
+
+        if (!begin[1] || !end[1])
+            continue;
+
+        uint64_t ticks = ((end[0] & m_timestamp_mask) - (begin[0] & m_timestamp_mask)) & m_timestamp_mask;
+        double duration = ticks * m_timestamp_period / 1e6;
+
+        Zone &zone = m_zones[i];
+        zone.last_duration = duration;
+
+        if (Trace::is_enabled())
+        {
+            uint64_t offset = static_cast<uint64_t>((((begin[0] & m_timestamp_mask) - first_timestamp) & m_timestamp_mask) * m_timestamp_period);
+            Trace::record(Trace::Track::gpu, zone.name.c_str(), m_slot_submit_times[slot] + offset, static_cast<uint64_t>(ticks * m_timestamp_period));
+        }
+
+        if (zone.history.size() < GPU_PROFILER_HISTORY)
+            zone.history.push_back(duration);
+        else
+            zone.history[zone.history_next] = duration;
+
+        zone.history_next = (zone.history_next + 1) % GPU_PROFILER_HISTORY;
+    }
+
+    if (++m_resolved_slots % GPU_PROFILER_HISTORY == 0)
+        log_statistics();
+}
+
+Statistics GpuProfiler::zone_statistics(uint32_t zone) const
+{
+    return compute_statistics(m_zones[zone].history);
+}
+
+void GpuProfiler::create_query_pool(uint32_t slot_count)
+{
+    VkQueryPoolCreateInfo create_info{};
+    create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    create_info.queryCount = slot_count * MAX_ZONES * 2;
+
+    if (vkCreateQueryPool(m_device, &create_info, nullptr, &m_query_pool) != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_CREATE_QUERY_POOL_FAILURE");
+
+    m_slot_submit_times.resize(slot_count, 0);
+}
+
+void GpuProfiler::log_statistics() const
+{
+    SPDLOG_INFO("GPU time over the last {} frames:", GPU_PROFILER_HISTORY);
+
+    for (auto i = 0; i < m_zones.size(); i++)
+    {
+        if (m_zones[i].history.empty())
+            continue;
+
+        Statistics statistics = zone_statistics(i);
+        SPDLOG_INFO("\t{:<12} min {:.3f} ms, avg {:.3f} ms, p99 {:.3f} ms", m_zones[i].name, statistics.min, statistics.mean, statistics.p99);
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "statistics.h"
+
+// Timestamp queries around named zones. Every slot owns its own range of the query pool, so a slot can be recorded
+// again as soon as the submission that last used it is known to be complete, and reading it back never waits.
+class GpuProfiler
+{
+public:
+    void create(VkPhysicalDevice physical_device, VkDevice device, uint32_t queue_family_index, uint32_t slot_count);
+    void destroy();
+
+    uint32_t register_zone(const std::string &name);
+
+    void begin_slot(VkCommandBuffer command_buffer, uint32_t slot);
+    void begin_zone(VkCommandBuffer command_buffer, uint32_t slot, uint32_t zone);
+    void end_zone(VkCommandBuffer command_buffer, uint32_t slot, uint32_t zone);
+
+    // Anchors the slot's GPU ranges on the trace timeline, there's no shared clock so the submission time stands in for
+    // the moment the GPU started on it.
+    void set_slot_submit_time(uint32_t slot, uint64_t trace_time);
+
+    void resolve(uint32_t slot);
+
+    bool is_enabled() const { return m_query_pool != VK_NULL_HANDLE; }
+    Statistics zone_statistics(uint32_t zone) const;
+    double last_zone_duration(uint32_t zone) const { return m_zones[zone].last_duration; }
+
+private:
+    struct Zone
+    {
+        std::string name;
+        std::vector<double> history;
+        size_t history_next = 0;
+        double last_duration = 0.0;
+    };
+
+    void create_query_pool(uint32_t slot_count);
+    void log_statistics() const;
+
+    uint32_t query_index(uint32_t slot, uint32_t zone) const { return (slot * MAX_ZONES + zone) * 2; }
+
+    static constexpr uint32_t MAX_ZONES = 16;
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkQueryPool m_query_pool = VK_NULL_HANDLE;
+    double m_timestamp_period = 0.0;
+    uint64_t m_timestamp_mask = 0;
+    std::vector<Zone> m_zones;
+    std::vector<uint64_t> m_slot_submit_times;
+    uint64_t m_resolved_slots = 0;
+};
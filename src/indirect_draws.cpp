@@ -0,0 +1,232 @@
+#include "indirect_draws.h"
+
+#include <cstddef>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+void IndirectDraws::create(MemoryAllocator &allocator, VkDevice device, VkPipelineCache pipeline_cache, DescriptorSetCache &descriptor_cache,
+                           const uint32_t *shader_code, size_t shader_size, const std::vector<DrawRange> &draw_ranges,
+                           const std::vector<DrawBounds> &draw_bounds, const DrawBounds &mesh_bounds, uint32_t instance_count,
+                           const std::vector<uint32_t> &queue_family_indices, uint32_t frame_count, Features features)
+{
+    m_allocator = &allocator;
+    m_device = device;
+    m_descriptor_cache = &descriptor_cache;
+    m_features = features;
+    m_object_count = static_cast<uint32_t>(draw_ranges.size());
+    m_instance_count = instance_count;
+    m_mesh_bounds = mesh_bounds;
+
+    // Written once by the host and only ever read by the compute pass, so it doesn't need a staged upload.
+    const VkDeviceSize object_buffer_size = draw_ranges.size() * sizeof(Object);
+    m_object_buffer = m_allocator->create_buffer(object_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    Object *objects = static_cast<Object *>(m_object_buffer.allocation.mapped);
+    for (uint32_t i = 0; i < m_object_count; i++)
+        objects[i] = {draw_ranges[i], draw_bounds[i]};
+
+    m_allocator->flush(m_object_buffer.allocation);
+
+    // One set per frame in flight, a frame's pass never overwrites commands an earlier frame is still drawing with.
+    const VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+    m_command_buffers.resize(frame_count);
+    m_count_buffers.resize(frame_count);
+    m_readback_buffers.resize(frame_count);
+    m_visible_instance_buffers.resize(frame_count);
+
+    for (uint32_t i = 0; i < frame_count; i++)
+    {
+        m_command_buffers[i] = m_allocator->create_buffer(m_object_count * sizeof(VkDrawIndexedIndirectCommand), usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, queue_family_indices);
+        m_count_buffers[i] = m_allocator->create_buffer(sizeof(CountBuffer), usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, queue_family_indices);
+
+        // The shader's atomics stay in device memory, only the final counts are copied out where the host can see them.
+        m_readback_buffers[i] = m_allocator->create_buffer(sizeof(Counters), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+        *static_cast<Counters *>(m_readback_buffers[i].allocation.mapped) = {};
+
+        // Sized for every instance being visible, the pass only ever fills the front of it.
+        m_visible_instance_buffers[i] = m_allocator->create_buffer(m_instance_count * sizeof(Instance), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, queue_family_indices);
+    }
+
+    create_pipeline(pipeline_cache, shader_code, shader_size);
+
+    SPDLOG_INFO("Indirect draws: {} objects of {} instances culled on the GPU, {}", m_object_count, m_instance_count,
+                m_features.draw_indirect_count ? "compacted with vkCmdDrawIndexedIndirectCount" : "vkCmdDrawIndexedIndirect fallback");
+}
+
+void IndirectDraws::destroy()
+{
+    if (m_device == VK_NULL_HANDLE)
+        return;
+
+    vkDestroyPipeline(m_device, m_pipeline, nullptr);
+    vkDestroyPipelineLayout(m_device, m_pipeline_layout, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_descriptor_set_layout, nullptr);
+
+    for (auto &buffer : m_command_buffers)
+        m_allocator->destroy_buffer(buffer);
+
+    for (auto &buffer : m_count_buffers)
+        m_allocator->destroy_buffer(buffer);
+
+    for (auto &buffer : m_readback_buffers)
+        m_allocator->destroy_buffer(buffer);
+
+    for (auto &buffer : m_visible_instance_buffers)
+        m_allocator->destroy_buffer(buffer);
+
+    m_allocator->destroy_buffer(m_object_buffer);
+
+    m_command_buffers.clear();
+    m_count_buffers.clear();
+    m_readback_buffers.clear();
+    m_visible_instance_buffers.clear();
+    m_device = VK_NULL_HANDLE;
+}
+
+void IndirectDraws::record_generate(VkCommandBuffer command_buffer, uint32_t frame, VkBuffer instance_buffer, float zoom)
+{
+    vkCmdFillBuffer(command_buffer, m_count_buffers[frame].buffer, 0, sizeof(CountBuffer), 0);
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    PushConstants push_constants{};
+    push_constants.mesh_bounds = m_mesh_bounds;
+    push_constants.object_count = m_object_count;
+    push_constants.compact = m_features.draw_indirect_count ? 1 : 0;
+    push_constants.instance_count = m_instance_count;
+    push_constants.zoom = zoom;
+
+    const std::vector<DescriptorBinding> bindings = {
+        {0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_object_buffer.buffer},
+        {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_command_buffers[frame].buffer},
+        {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_count_buffers[frame].buffer},
+        {3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, instance_buffer},
+        {4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_visible_instance_buffers[frame].buffer},
+    };
+
+    // The same buffers come back every time the frame does, so after the first pass this is only a cache lookup.
+    VkDescriptorSet descriptor_set = m_descriptor_cache->get(m_descriptor_set_layout, bindings);
+
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline_layout, 0, 1, &descriptor_set, 0, nullptr);
+
+    // The instances first, the objects' commands need the final count of visible ones.
+    push_constants.phase = 0;
+    vkCmdPushConstants(command_buffer, m_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants), &push_constants);
+    vkCmdDispatch(command_buffer, (m_instance_count + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    push_constants.phase = 1;
+    vkCmdPushConstants(command_buffer, m_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants), &push_constants);
+    vkCmdDispatch(command_buffer, (m_object_count + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    VkBufferCopy region{offsetof(CountBuffer, counters), 0, sizeof(Counters)};
+    vkCmdCopyBuffer(command_buffer, m_count_buffers[frame].buffer, m_readback_buffers[frame].buffer, 1, &region);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+IndirectDraws::Counters IndirectDraws::read_counters(uint32_t frame) const
+{
+    return *static_cast<const Counters *>(m_readback_buffers[frame].allocation.mapped);
+}
+
+void IndirectDraws::bind_instances(VkCommandBuffer command_buffer, uint32_t binding, uint32_t frame) const
+{
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(command_buffer, binding, 1, &m_visible_instance_buffers[frame].buffer, &offset);
+}
+
+void IndirectDraws::draw(VkCommandBuffer command_buffer, uint32_t frame) const
+{
+    const VkBuffer commands = m_command_buffers[frame].buffer;
+    const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+    if (m_features.draw_indirect_count)
+        vkCmdDrawIndexedIndirectCount(command_buffer, commands, 0, m_count_buffers[frame].buffer, 0, m_object_count, stride);
+    else if (m_features.multi_draw_indirect)
+        vkCmdDrawIndexedIndirect(command_buffer, commands, 0, m_object_count, stride);
+    else
+        for (uint32_t i = 0; i < m_object_count; i++)
+            vkCmdDrawIndexedIndirect(command_buffer, commands, i * stride, 1, stride);
+}
+
+void IndirectDraws::create_pipeline(VkPipelineCache pipeline_cache, const uint32_t *shader_code, size_t shader_size)
+{
+    VkDescriptorSetLayoutBinding bindings[5]{};
+    for (uint32_t i = 0; i < 5; i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info{};
+    descriptor_set_layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    descriptor_set_layout_create_info.bindingCount = 5;
+    descriptor_set_layout_create_info.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(m_device, &descriptor_set_layout_create_info, nullptr, &m_descriptor_set_layout) != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_CREATE_DESCRIPTOR_SET_LAYOUT_FAILURE");
+
+    VkPushConstantRange push_constant_range{};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = sizeof(PushConstants);
+
+    VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
+    pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_create_info.setLayoutCount = 1;
+    pipeline_layout_create_info.pSetLayouts = &m_descriptor_set_layout;
+    pipeline_layout_create_info.pushConstantRangeCount = 1;
+    pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+
+    if (vkCreatePipelineLayout(m_device, &pipeline_layout_create_info, nullptr, &m_pipeline_layout) != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_CREATE_PIPELINE_LAYOUT_FAILURE");
+
+    VkShaderModuleCreateInfo shader_module_create_info{};
+    shader_module_create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shader_module_create_info.codeSize = shader_size;
+    shader_module_create_info.pCode = shader_code;
+
+    VkShaderModule shader_module;
+    if (vkCreateShaderModule(m_device, &shader_module_create_info, nullptr, &shader_module) != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_CREATE_SHADER_MODULE_FAILURE");
+
+    VkComputePipelineCreateInfo pipeline_create_info{};
+    pipeline_create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_create_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_create_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_create_info.stage.module = shader_module;
+    pipeline_create_info.stage.pName = "main";
+    pipeline_create_info.layout = m_pipeline_layout;
+
+    VkResult result = vkCreateComputePipelines(m_device, pipeline_cache, 1, &pipeline_create_info, nullptr, &m_pipeline);
+    vkDestroyShaderModule(m_device, shader_module, nullptr);
+
+    if (result != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_CREATE_COMPUTE_PIPELINE_FAILURE");
+}
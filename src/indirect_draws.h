@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "descriptor_allocator.h"
+#include "instances.h"
+#include "memory_allocator.h"
+#include "mesh.h"
+
+// Draw arguments written by a compute pass instead of the CPU. The pass first tests every instance against the view and
+// copies the visible ones into a compacted instance buffer, which the draws bind in place of the InstanceBuffer. Then
+// every draw range is an object it tests and turns into a VkDrawIndexedIndirectCommand drawing the visible instances,
+// so the graphics side issues one indirect call no matter how many objects there are. With drawIndirectCount the
+// visible commands are compacted and the pass also writes their count, otherwise every object keeps its slot and a
+// culled one is written with an instance count of zero.
+class IndirectDraws
+{
+public:
+    struct Features
+    {
+        bool draw_indirect_count;
+        bool multi_draw_indirect;
+    };
+
+    // Instances drawn and culled, summed over the objects, so with a single object they are just the instances.
+    struct Counters
+    {
+        uint32_t drawn;
+        uint32_t culled;
+    };
+
+    // The command and count buffers are written on the compute queue and read by the graphics queue, queue_family_indices
+    // lists both families when they differ. The pass finds its descriptor sets in descriptor_cache, which must outlive it.
+    // shader_size is the SPIR-V's size in bytes. Instances are culled with mesh_bounds, objects with draw_bounds, which
+    // must already cover every instance.
+    void create(MemoryAllocator &allocator, VkDevice device, VkPipelineCache pipeline_cache, DescriptorSetCache &descriptor_cache,
+                const uint32_t *shader_code, size_t shader_size, const std::vector<DrawRange> &draw_ranges,
+                const std::vector<DrawBounds> &draw_bounds, const DrawBounds &mesh_bounds, uint32_t instance_count,
+                const std::vector<uint32_t> &queue_family_indices, uint32_t frame_count, Features features);
+    void destroy();
+
+    // Clears the frame's counters, culls the instances in instance_buffer and then the objects against a view scaled by
+    // zoom and writes the draw commands, recorded on the compute queue. The counters are copied back for read_counters
+    // once the frame is done.
+    void record_generate(VkCommandBuffer command_buffer, uint32_t frame, VkBuffer instance_buffer, float zoom);
+
+    // Instances drawn and culled by the frame's last pass, only valid after that frame's submission has completed.
+    Counters read_counters(uint32_t frame) const;
+
+    // Binds the frame's visible instances where the InstanceBuffer would go.
+    void bind_instances(VkCommandBuffer command_buffer, uint32_t binding, uint32_t frame) const;
+
+    // Draws with the frame's commands, the mesh and the visible instances must already be bound.
+    void draw(VkCommandBuffer command_buffer, uint32_t frame) const;
+
+    uint32_t object_count() const { return m_object_count; }
+    bool uses_draw_count() const { return m_features.draw_indirect_count; }
+
+private:
+    struct PushConstants
+    {
+        DrawBounds mesh_bounds;
+        uint32_t object_count;
+        uint32_t compact;
+        uint32_t instance_count;
+        float zoom;
+        uint32_t phase;
+    };
+
+    // Matches the CountBuffer of draw_commands.comp.
+    struct CountBuffer
+    {
+        uint32_t draw_count;
+        uint32_t visible_instance_count;
+        Counters counters;
+    };
+
+    // Matches the Object struct of draw_commands.comp.
+    struct Object
+    {
+        DrawRange range;
+        DrawBounds bounds;
+    };
+
+    static constexpr uint32_t WORKGROUP_SIZE = 64;
+
+    void create_pipeline(VkPipelineCache pipeline_cache, const uint32_t *shader_code, size_t shader_size);
+
+    MemoryAllocator *m_allocator = nullptr;
+    VkDevice m_device = VK_NULL_HANDLE;
+    DescriptorSetCache *m_descriptor_cache = nullptr;
+    Features m_features{};
+    uint32_t m_object_count = 0;
+    uint32_t m_instance_count = 1;
+    DrawBounds m_mesh_bounds{};
+
+    Buffer m_object_buffer;
+    std::vector<Buffer> m_command_buffers;
+    std::vector<Buffer> m_count_buffers;
+    std::vector<Buffer> m_readback_buffers;
+    std::vector<Buffer> m_visible_instance_buffers;
+
+    VkDescriptorSetLayout m_descriptor_set_layout = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipeline_layout = VK_NULL_HANDLE;
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
+};
@@ -0,0 +1,111 @@
+#include "instances.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include <spdlog/spdlog.h>
+
+#include "trace.h"
+
+// Instances fill the same part of the screen as the grid scene.
+static constexpr float FIELD_EXTENT = 0.9f;
+
+void InstanceBuffer::create(MemoryAllocator &allocator, uint32_t instance_count, uint32_t material_count, uint32_t frame_count)
+{
+    TRACE_FUNCTION();
+
+    m_allocator = &allocator;
+    m_instance_count = instance_count;
+    m_material_count = std::max(1u, material_count);
+    m_columns = std::max(1u, static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(instance_count)))));
+    m_rows = std::max(1u, (instance_count + m_columns - 1) / m_columns);
+
+    // Read straight from host memory by the vertex fetch or the culling pass, preferably through a device local window onto it.
+    m_buffers.resize(frame_count);
+    for (auto &buffer : m_buffers)
+        buffer = m_allocator->create_buffer(instance_count * sizeof(Instance), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    SPDLOG_INFO("Instances: {} per draw, {:.2f} MiB rewritten per frame", m_instance_count, instance_count * sizeof(Instance) / 1048576.0);
+}
+
+void InstanceBuffer::destroy()
+{
+    if (m_allocator == nullptr)
+        return;
+
+    for (auto &buffer : m_buffers)
+        m_allocator->destroy_buffer(buffer);
+
+    m_buffers.clear();
+    m_allocator = nullptr;
+}
+
+void InstanceBuffer::update(uint32_t frame, float time, JobSystem &job_system)
+{
+    TRACE_FUNCTION();
+
+    Instance *instances = static_cast<Instance *>(m_buffers[frame].allocation.mapped);
+
+    if (m_instance_count == 1)
+        instances[0] = {{0.0f, 0.0f}, 1.0f, 0.0f, {1.0f, 1.0f, 1.0f}, 0};
+    else
+    {
+        const float cell = 2.0f * FIELD_EXTENT / std::max(m_columns, m_rows);
+
+        // Every instance owns its slot, so the batches need no synchronisation.
+        job_system.parallel_for(m_instance_count, 16384, [this, instances, time, cell](uint32_t, uint32_t index)
+                                {
+                                    const uint32_t x = index % m_columns;
+                                    const uint32_t y = index / m_columns;
+                                    const float u = static_cast<float>(x) / m_columns;
+                                    const float v = static_cast<float>(y) / m_rows;
+
+                                    Instance &instance = instances[index];
+                                    instance.offset = {-FIELD_EXTENT + cell * (x + 0.5f), -FIELD_EXTENT + cell * (y + 0.5f)};
+                                    instance.scale = cell;
+                                    instance.rotation = time + index * 0.001f;
+                                    instance.color = {0.5f + 0.5f * u, 0.5f + 0.5f * v, 1.0f - 0.5f * u * v};
+                                    instance.material = index % m_material_count; });
+    }
+
+    m_allocator->flush(m_buffers[frame].allocation);
+}
+
+void InstanceBuffer::bind(VkCommandBuffer command_buffer, uint32_t binding, uint32_t frame) const
+{
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(command_buffer, binding, 1, &m_buffers[frame].buffer, &offset);
+}
+
+DrawBounds InstanceBuffer::bounds(const DrawBounds &mesh_bounds) const
+{
+    if (m_instance_count == 1)
+        return mesh_bounds;
+
+    // Rotation is animated, so an instance can reach as far as the mesh's furthest corner in any direction.
+    const float cell = 2.0f * FIELD_EXTENT / std::max(m_columns, m_rows);
+    const glm::vec2 corner = glm::max(glm::abs(mesh_bounds.min), glm::abs(mesh_bounds.max));
+    const float radius = cell * std::sqrt(corner.x * corner.x + corner.y * corner.y);
+
+    const glm::vec2 first = {-FIELD_EXTENT + cell * 0.5f, -FIELD_EXTENT + cell * 0.5f};
+    const glm::vec2 last = {-FIELD_EXTENT + cell * (m_columns - 0.5f), -FIELD_EXTENT + cell * (m_rows - 0.5f)};
+
+    return {{first.x - radius, first.y - radius}, {last.x + radius, last.y + radius}};
+}
+
+VkVertexInputBindingDescription InstanceBuffer::binding_description(uint32_t binding)
+{
+    return {binding, sizeof(Instance), VK_VERTEX_INPUT_RATE_INSTANCE};
+}
+
+std::vector<VkVertexInputAttributeDescription> InstanceBuffer::attribute_descriptions(uint32_t binding, uint32_t first_location)
+{
+    // Offset, scale and rotation share one vec4 attribute.
+    return {
+        {first_location, binding, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(Instance, offset)},
+        {first_location + 1, binding, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Instance, color)},
+        {first_location + 2, binding, VK_FORMAT_R32_UINT, offsetof(Instance, material)},
+    };
+}
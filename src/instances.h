@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+
+#include "job_system.h"
+#include "memory_allocator.h"
+#include "mesh.h"
+
+// Matches the per-instance attributes of shader.vert.
+struct Instance
+{
+    glm::vec2 offset;
+    float scale;
+    float rotation;
+    glm::vec3 color;
+    uint32_t material;
+};
+
+// Per-instance attributes that the CPU rewrites every frame. Each frame in flight has its own persistently mapped copy,
+// so writing a frame's instances never touches the ones an earlier frame is still drawing with.
+class InstanceBuffer
+{
+public:
+    // Instances cycle through material ids below material_count.
+    void create(MemoryAllocator &allocator, uint32_t instance_count, uint32_t material_count, uint32_t frame_count);
+    void destroy();
+
+    // Lays the instances out on a grid over the screen and spins each one around its centre. A single instance is the
+    // untransformed mesh.
+    void update(uint32_t frame, float time, JobSystem &job_system);
+    void bind(VkCommandBuffer command_buffer, uint32_t binding, uint32_t frame) const;
+
+    // The frame's copy, also readable as a storage buffer by the GPU culling pass.
+    VkBuffer buffer(uint32_t frame) const { return m_buffers[frame].buffer; }
+
+    // Box around everywhere update can place something that fits in mesh_bounds.
+    DrawBounds bounds(const DrawBounds &mesh_bounds) const;
+
+    static VkVertexInputBindingDescription binding_description(uint32_t binding);
+    static std::vector<VkVertexInputAttributeDescription> attribute_descriptions(uint32_t binding, uint32_t first_location);
+
+    uint32_t instance_count() const { return m_instance_count; }
+
+private:
+    MemoryAllocator *m_allocator = nullptr;
+    uint32_t m_instance_count = 0;
+    uint32_t m_material_count = 1;
+    uint32_t m_columns = 1;
+    uint32_t m_rows = 1;
+    std::vector<Buffer> m_buffers;
+};
@@ -0,0 +1,263 @@
+#include "job_system.h"
+
+#include <algorithm>
+#include <exception>
+
+#include <spdlog/spdlog.h>
+
+#include "trace.h"
+
+static thread_local uint32_t t_thread_index = 0;
+
+void JobSystem::create(uint32_t worker_count)
+{
+    m_stopping = false;
+
+    for (uint32_t i = 0; i <= worker_count; i++)
+        m_queues.push_back(std::make_unique<ThreadState>());
+
+    reset_utilisation();
+
+    for (uint32_t i = 1; i <= worker_count; i++)
+        m_threads.emplace_back(&JobSystem::work, this, i);
+}
+
+void JobSystem::destroy()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        m_stopping = true;
+    }
+
+    m_work_available.notify_all();
+
+    for (auto &thread : m_threads)
+        thread.join();
+
+    m_threads.clear();
+    m_queues.clear();
+}
+
+JobSystem::JobHandle JobSystem::submit(Function function, const std::vector<JobHandle> &dependencies)
+{
+    auto job = std::make_shared<Job>();
+    job->function = std::move(function);
+
+    // Held until every dependency has been registered, so one finishing meanwhile can't release the job early.
+    job->pending_dependencies = static_cast<uint32_t>(dependencies.size()) + 1;
+
+    for (const auto &dependency : dependencies)
+    {
+        std::lock_guard<std::mutex> lock(dependency->mutex);
+
+        if (dependency->completed)
+            job->pending_dependencies--;
+        else
+            dependency->continuations.push_back(job);
+    }
+
+    if (--job->pending_dependencies == 0)
+        enqueue(job);
+
+    return job;
+}
+
+void JobSystem::wait(const JobHandle &job)
+{
+    while (!job->finished)
+        if (!run_one(t_thread_index))
+            std::this_thread::yield();
+
+    if (job->exception)
+        std::rethrow_exception(job->exception);
+}
+
+void JobSystem::parallel_for(uint32_t count, uint32_t batch_size, const std::function<void(uint32_t thread, uint32_t index)> &function)
+{
+    std::vector<JobHandle> jobs;
+
+    for (uint32_t first = 0; first < count; first += batch_size)
+    {
+        const uint32_t last = std::min(count, first + batch_size);
+
+        jobs.push_back(submit([&function, first, last](uint32_t thread)
+                              {
+                                  for (uint32_t i = first; i < last; i++)
+                                      function(thread, i); }));
+    }
+
+    // The jobs call function by reference, so a failure is only passed on once every one of them has finished.
+    std::exception_ptr exception;
+
+    for (const auto &job : jobs)
+    {
+        try
+        {
+            wait(job);
+        }
+        catch (...)
+        {
+            if (!exception)
+                exception = std::current_exception();
+        }
+    }
+
+    if (exception)
+        std::rethrow_exception(exception);
+}
+
+std::vector<JobSystem::Utilisation> JobSystem::utilisation() const
+{
+    const double elapsed_ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_utilisation_start).count());
+
+    std::vector<Utilisation> utilisation;
+
+    for (const auto &queue : m_queues)
+    {
+        const uint64_t busy_ns = queue->busy_ns;
+        utilisation.push_back({queue->executed_jobs, busy_ns / 1e6, elapsed_ns > 0.0 ? busy_ns / elapsed_ns : 0.0});
+    }
+
+    return utilisation;
+}
+
+void JobSystem::reset_utilisation()
+{
+    for (auto &queue : m_queues)
+    {
+        queue->busy_ns = 0;
+        queue->executed_jobs = 0;
+    }
+
+    m_utilisation_start = std::chrono::steady_clock::now();
+}
+
+void JobSystem::log_utilisation() const
+{
+    const auto threads = utilisation();
+
+    SPDLOG_INFO("Job system utilisation:");
+    for (size_t i = 0; i < threads.size(); i++)
+        SPDLOG_INFO("\t{} {}: {} jobs, {:.3f} ms busy ({:.1f}%)", i == 0 ? "main thread" : "worker", i, threads[i].jobs, threads[i].busy_ms, threads[i].utilisation * 100.0);
+}
+
+void JobSystem::enqueue(JobHandle job)
+{
+    // Counted before it's visible, so a thief can never take it before the count includes it.
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        m_queued_jobs++;
+    }
+
+    {
+        ThreadState &queue = *m_queues[t_thread_index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+    }
+
+    m_work_available.notify_one();
+}
+
+bool JobSystem::run_one(uint32_t thread)
+{
+    JobHandle job = take_job(thread);
+
+    if (!job)
+        return false;
+
+    execute(thread, job);
+
+    return true;
+}
+
+JobSystem::JobHandle JobSystem::take_job(uint32_t thread)
+{
+    // Newest first from our own deque, it's the most likely to still be in cache.
+    {
+        ThreadState &queue = *m_queues[thread];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (!queue.jobs.empty())
+        {
+            JobHandle job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+            m_queued_jobs--;
+
+            return job;
+        }
+    }
+
+    // Oldest first from everyone else's, those tend to be the biggest pieces of work left.
+    for (uint32_t offset = 1; offset < m_queues.size(); offset++)
+    {
+        ThreadState &victim = *m_queues[(thread + offset) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+
+        if (!victim.jobs.empty())
+        {
+            JobHandle job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            m_queued_jobs--;
+
+            return job;
+        }
+    }
+
+    return nullptr;
+}
+
+void JobSystem::execute(uint32_t thread, const JobHandle &job)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    {
+        TRACE_SCOPE("job");
+
+        try
+        {
+            job->function(thread);
+        }
+        catch (...)
+        {
+            job->exception = std::current_exception();
+        }
+    }
+
+    ThreadState &state = *m_queues[thread];
+    state.busy_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    state.executed_jobs++;
+
+    std::vector<JobHandle> continuations;
+
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->completed = true;
+        continuations.swap(job->continuations);
+    }
+
+    // Continuations run even when a dependency threw, they can check it themselves through their handles.
+    for (auto &continuation : continuations)
+        if (--continuation->pending_dependencies == 0)
+            enqueue(std::move(continuation));
+
+    job->function = nullptr;
+    job->finished = true;
+}
+
+void JobSystem::work(uint32_t thread)
+{
+    t_thread_index = thread;
+
+    for (;;)
+    {
+        if (run_one(thread))
+            continue;
+
+        std::unique_lock<std::mutex> lock(m_sleep_mutex);
+        m_work_available.wait(lock, [this]()
+                              { return m_stopping || m_queued_jobs > 0; });
+
+        if (m_stopping)
+            return;
+    }
+}
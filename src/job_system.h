@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing task scheduler. Every thread owns a deque: it pushes and pops its own jobs at the back, idle threads
+// steal from the front of the others'. Jobs may depend on other jobs and only become runnable once those have finished.
+// The thread that created the system takes part as thread 0 while it waits, workers are threads 1 and up, so per-thread
+// state can be indexed with the thread index passed to every job.
+class JobSystem
+{
+public:
+    using Function = std::function<void(uint32_t thread)>;
+
+    struct Job;
+    using JobHandle = std::shared_ptr<Job>;
+
+    struct Utilisation
+    {
+        uint64_t jobs;
+        double busy_ms;
+        double utilisation;
+    };
+
+    void create(uint32_t worker_count);
+    void destroy();
+
+    JobHandle submit(Function function, const std::vector<JobHandle> &dependencies = {});
+
+    // Runs jobs on the calling thread until the given one has finished, then rethrows the exception it ended with, if
+    // any. Only the thread that created the system may wait.
+    void wait(const JobHandle &job);
+
+    // Calls function(thread, i) for every i below count, batch_size indices per job, and waits for all of them. Rethrows
+    // the first exception a job threw, after the rest have finished.
+    void parallel_for(uint32_t count, uint32_t batch_size, const std::function<void(uint32_t thread, uint32_t index)> &function);
+
+    uint32_t thread_count() const { return static_cast<uint32_t>(m_queues.size()); }
+
+    // Per thread, since the last reset.
+    std::vector<Utilisation> utilisation() const;
+    void reset_utilisation();
+    void log_utilisation() const;
+
+private:
+    struct alignas(64) ThreadState
+    {
+        std::mutex mutex;
+        std::deque<JobHandle> jobs;
+        std::atomic<uint64_t> busy_ns{0};
+        std::atomic<uint64_t> executed_jobs{0};
+    };
+
+    void enqueue(JobHandle job);
+    bool run_one(uint32_t thread);
+    JobHandle take_job(uint32_t thread);
+    void execute(uint32_t thread, const JobHandle &job);
+    void work(uint32_t thread);
+
+    std::vector<std::unique_ptr<ThreadState>> m_queues;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_work_available;
+    std::atomic<uint32_t> m_queued_jobs{0};
+    bool m_stopping = false;
+
+    std::chrono::steady_clock::time_point m_utilisation_start;
+};
+
+struct JobSystem::Job
+{
+    Function function;
+    std::atomic<uint32_t> pending_dependencies{0};
+    std::atomic<bool> finished{false};
+    std::exception_ptr exception;
+
+    std::mutex mutex;
+    std::vector<JobHandle> continuations;
+    bool completed = false;
+};
@@ -3,15 +3,38 @@
 #include <algorithm>
 #include <optional>
 #include <set>
-#include <fstream>
+#include <cstring>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <unordered_map>
 
-#define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_TRACE
 #include <spdlog/spdlog.h>
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
 #include "HelloVulkan_config.h"
+#include "benchmark.h"
+#include "bindless.h"
+#include "descriptor_allocator.h"
+#include "embedded_shaders.h"
+#include "gpu_profiler.h"
+#include "indirect_draws.h"
+#include "instances.h"
+#include "job_system.h"
+#include "materials.h"
+#include "memory_allocator.h"
+#include "mesh.h"
+#include "options.h"
+#include "pipeline_cache.h"
+#include "shader_reloader.h"
+#include "staging_ring.h"
+#include "statistics.h"
+#include "trace.h"
+#include "uniform_ring.h"
+#include "upload_scheduler.h"
 
 #ifdef NDEBUG
 const bool enable_validation_layers = false;
@@ -37,13 +60,42 @@ void proxy_vkDestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMess
         function(instance, debug_messenger, allocator);
 }
 
+VkResult proxy_vkCreateHeadlessSurfaceEXT(VkInstance instance, const VkHeadlessSurfaceCreateInfoEXT *create_info, const VkAllocationCallbacks *allocator, VkSurfaceKHR *surface)
+{
+    auto function = (PFN_vkCreateHeadlessSurfaceEXT)vkGetInstanceProcAddr(instance, "vkCreateHeadlessSurfaceEXT");
+
+    if (function != nullptr)
+        return function(instance, create_info, allocator, surface);
+    else
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+}
+
 class HelloTriangleApplication
 {
 public:
+    explicit HelloTriangleApplication(const Options &options) : m_options(options)
+    {
+        // Nothing is presented offscreen, so don't turn away devices without swapchain support.
+        if (m_options.headless == HeadlessMode::offscreen)
+            m_device_extensions.erase(std::remove_if(m_device_extensions.begin(), m_device_extensions.end(), [](const char *extension)
+                                                     { return !std::strcmp(extension, VK_KHR_SWAPCHAIN_EXTENSION_NAME); }),
+                                      m_device_extensions.end());
+
+        if (m_options.benchmark)
+            m_benchmark.emplace(m_options.warmup_frames, m_options.frames);
+    }
+
     void run()
     {
-        init_window();
+        if (m_options.headless == HeadlessMode::none)
+            init_window();
+
+        auto init_start = std::chrono::steady_clock::now();
         init_vulkan();
+        std::chrono::duration<double, std::milli> init_duration = std::chrono::steady_clock::now() - init_start;
+
+        SPDLOG_INFO("Vulkan initialized in {:.3f} ms ({} pipeline cache)", init_duration.count(), m_pipeline_cache.is_warm() ? "warm" : "cold");
+
         main_loop();
         cleanup();
     }
@@ -51,19 +103,39 @@ public:
 private:
     void init_vulkan()
     {
+        TRACE_FUNCTION();
+
         create_instance();
         setup_debug_messenger();
         create_surface();
         pick_physical_device();
         create_logical_device();
+        create_memory_allocator();
+        create_pipeline_cache();
         create_swapchain();
         create_image_views();
         create_render_pass();
+        create_bindless_heap();
+        create_descriptor_allocators();
+        create_uniform_ring();
         create_graphics_pipeline();
         create_framebuffers();
-        create_command_pool();
-        create_command_buffers();
+        create_job_system();
+        create_command_pools();
+        create_staging_ring();
+        create_upload_scheduler();
+        create_materials();
+        create_instance_buffer();
+        create_mesh();
+        create_compute_pipeline();
+        create_tint_buffers();
+        create_indirect_draws();
+        create_gpu_profiler();
         create_sync_objects();
+
+#ifdef HOT_RELOAD
+        create_shader_reloader();
+#endif
     }
 
     void init_window()
@@ -79,54 +151,188 @@ private:
 
     void main_loop()
     {
-        while (!glfwWindowShouldClose(m_window))
+        if (m_options.resize_storm > 0)
         {
-            glfwPollEvents();
+            if (m_window)
+                run_resize_storm();
+            else
+                SPDLOG_WARN("Resize storm needs a window, skipping");
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        uint32_t frame_count = 0;
+
+        m_job_system.reset_utilisation();
+
+        while (!m_window || !glfwWindowShouldClose(m_window))
+        {
+            TRACE_SCOPE("frame");
+
+            if (m_window)
+                glfwPollEvents();
+
+#ifdef HOT_RELOAD
+            reload_shaders();
+#endif
+
+            if (m_benchmark)
+                m_benchmark->begin_frame();
+
             draw();
+            frame_count++;
+
+            if (m_benchmark)
+            {
+                m_benchmark->end_frame();
+
+                if (m_benchmark->is_finished())
+                    break;
+            }
+            else if (m_options.frames > 0 && frame_count >= m_options.frames)
+                break;
         }
 
         vkDeviceWaitIdle(m_device);
+
+        m_job_system.log_utilisation();
+
+        if (m_benchmark)
+            finish_benchmark();
+
+        if (m_culled_frames > 0)
+            SPDLOG_INFO("Culling: {:.1f} instances drawn and {:.1f} culled per frame on average over {} frames",
+                        (double)m_drawn_instances / m_culled_frames, (double)m_culled_instances / m_culled_frames, m_culled_frames);
+
+        if (m_options.frames > 0)
+        {
+            std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+            SPDLOG_INFO("Rendered {} frames in {:.3f} s ({:.1f} fps)", frame_count, duration.count(), frame_count / duration.count());
+        }
+    }
+
+    void finish_benchmark()
+    {
+        // The device is idle, so the last frames' results can be collected too.
+        for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+            resolve_frame_results(i);
+
+        VkPhysicalDeviceProperties device_properties;
+        vkGetPhysicalDeviceProperties(m_physical_device, &device_properties);
+
+        m_benchmark->set_property("device", device_properties.deviceName);
+        m_benchmark->set_property("scene", scene_name(m_options.scene));
+        m_benchmark->set_property("triangles", std::to_string(m_mesh.index_count() / 3));
+        m_benchmark->set_property("instances", std::to_string(m_instance_buffer.instance_count()));
+        m_benchmark->set_property("vertex_layout", m_options.vertex_layout == VertexLayout::interleaved ? "interleaved" : "deinterleaved");
+        m_benchmark->set_property("draw_path", m_options.draw_path == DrawPath::indirect ? "indirect" : "direct");
+        m_benchmark->set_property("zoom", fmt::format("{}", m_options.zoom));
+        m_benchmark->set_property("present_mode", m_swapchain != VK_NULL_HANDLE ? present_mode_name(m_present_mode) : "offscreen");
+        m_benchmark->set_property("extent", fmt::format("{}x{}", m_swapchain_extent.width, m_swapchain_extent.height));
+
+        m_benchmark->log_summary();
+        m_benchmark->write_report(m_options.report_path);
     }
 
     void cleanup()
     {
+#ifdef HOT_RELOAD
+        m_shader_reloader.destroy();
+#endif
+
+        flush_deferred_deletions();
         cleanup_swapchain();
 
+        vkDestroyPipeline(m_device, m_graphics_pipeline, nullptr);
+        vkDestroyPipelineLayout(m_device, m_pipeline_layout, nullptr);
+        vkDestroyRenderPass(m_device, m_render_pass, nullptr);
+
+        for (auto &tint_buffer : m_tint_buffers)
+            m_memory_allocator.destroy_buffer(tint_buffer);
+
+        vkDestroyPipeline(m_device, m_compute_pipeline, nullptr);
+        vkDestroyPipelineLayout(m_device, m_compute_pipeline_layout, nullptr);
+        vkDestroyDescriptorSetLayout(m_device, m_compute_descriptor_set_layout, nullptr);
+        vkDestroyCommandPool(m_device, m_compute_command_pool, nullptr);
+
         for (auto i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
         {
             vkDestroySemaphore(m_device, m_render_finished_semaphores[i], nullptr);
             vkDestroySemaphore(m_device, m_image_available_semaphores[i], nullptr);
-            vkDestroyFence(m_device, m_in_flight_fences[i], nullptr);
         }
 
-        vkDestroyCommandPool(m_device, m_command_pool, nullptr);
+        vkDestroySemaphore(m_device, m_compute_timeline, nullptr);
+        vkDestroySemaphore(m_device, m_graphics_timeline, nullptr);
+
+        for (const auto &frame_commands : m_frame_commands)
+        {
+            vkDestroyCommandPool(m_device, frame_commands.command_pool, nullptr);
+
+            for (const auto &thread_commands : frame_commands.threads)
+                vkDestroyCommandPool(m_device, thread_commands.command_pool, nullptr);
+        }
+
+        m_job_system.destroy();
+
+        m_indirect_draws.destroy();
+        m_uniform_ring.destroy();
+        m_descriptor_cache.destroy();
+        m_frame_descriptors.destroy();
+        m_instance_buffer.destroy();
+        m_materials.destroy();
+        m_bindless_heap.destroy();
+        m_mesh.destroy();
+        m_upload_scheduler.destroy();
+        m_staging_ring.destroy();
+        m_gpu_profiler.destroy();
+        m_pipeline_cache.destroy();
+
+        m_memory_allocator.log_statistics();
+        m_memory_allocator.destroy();
+
         vkDestroyDevice(m_device, nullptr);
 
         if (enable_validation_layers)
             proxy_vkDestroyDebugUtilsMessengerEXT(m_instance, m_debug_messenger, nullptr);
 
-        vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+        if (m_surface != VK_NULL_HANDLE)
+            vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+
         vkDestroyInstance(m_instance, nullptr);
 
-        glfwDestroyWindow(m_window);
-        glfwTerminate();
+        if (m_window)
+        {
+            glfwDestroyWindow(m_window);
+            glfwTerminate();
+        }
     }
 
     void create_instance()
     {
+        TRACE_FUNCTION();
+
         VkApplicationInfo app_info{};
         app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
         app_info.pApplicationName = PROJECT_NAME;
         app_info.applicationVersion = VK_MAKE_VERSION(PROJECT_VERSION_MAJOR, PROJECT_VERSION_MINOR, PROJECT_VERSION_PATCH);
         app_info.pEngineName = "No Engine";
         app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        app_info.apiVersion = VK_API_VERSION_1_0;
+        app_info.apiVersion = VK_API_VERSION_1_2;
+
+        std::vector<const char *> extensions;
 
-        uint32_t glfw_extension_count = 0;
-        const char **glfw_extensions;
+        if (m_options.headless == HeadlessMode::none)
+        {
+            uint32_t glfw_extension_count = 0;
+            const char **glfw_extensions;
 
-        glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
-        std::vector<const char *> extensions(glfw_extensions, glfw_extensions + glfw_extension_count);
+            glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+            extensions.assign(glfw_extensions, glfw_extensions + glfw_extension_count);
+        }
+        else if (m_options.headless == HeadlessMode::surface)
+        {
+            extensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+            extensions.push_back(VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
+        }
 
         VkInstanceCreateInfo create_info{};
         create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -215,6 +421,8 @@ private:
 
     void setup_debug_messenger()
     {
+        TRACE_FUNCTION();
+
         if (!enable_validation_layers)
             return;
 
@@ -236,6 +444,8 @@ private:
 
     void pick_physical_device()
     {
+        TRACE_FUNCTION();
+
         uint32_t device_count = 0;
         vkEnumeratePhysicalDevices(m_instance, &device_count, nullptr);
 
@@ -270,20 +480,43 @@ private:
 
         bool extensions_supported = check_device_extensions(device);
 
-        bool swapchain_adequate = false;
-        if (extensions_supported)
+        bool swapchain_adequate = m_surface == VK_NULL_HANDLE;
+        if (extensions_supported && !swapchain_adequate)
         {
             SwapChainSupportDetails swapchain_support = query_Swap_chain_support(device);
             swapchain_adequate = !swapchain_support.formats.empty() && !swapchain_support.present_modes.empty();
         }
 
-        return indices.is_complete() && extensions_supported && swapchain_adequate;
+        return indices.is_complete() && extensions_supported && swapchain_adequate && check_device_features(device);
+    }
+
+    bool check_device_features(VkPhysicalDevice device)
+    {
+        VkPhysicalDeviceProperties device_properties;
+        vkGetPhysicalDeviceProperties(device, &device_properties);
+
+        if (device_properties.apiVersion < VK_API_VERSION_1_2)
+            return false;
+
+        VkPhysicalDeviceVulkan12Features vulkan12_features{};
+        vulkan12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &vulkan12_features;
+
+        vkGetPhysicalDeviceFeatures2(device, &features);
+
+        // Frame synchronisation is built on timeline semaphores, resource binding on descriptor indexing.
+        return vulkan12_features.timelineSemaphore && BindlessHeap::is_supported(vulkan12_features);
     }
 
     struct QueueFamilyIndices
     {
         std::optional<uint32_t> graphics_family;
         std::optional<uint32_t> present_family;
+        std::optional<uint32_t> transfer_family;
+        std::optional<uint32_t> compute_family;
 
         bool is_complete()
         {
@@ -306,8 +539,12 @@ private:
             if (queue_families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
                 indices.graphics_family = i;
 
+            // Offscreen rendering never presents, the graphics queue stands in for the present queue.
             VkBool32 present_support = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &present_support);
+            if (m_surface != VK_NULL_HANDLE)
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &present_support);
+            else
+                present_support = indices.graphics_family == static_cast<uint32_t>(i);
 
             if (present_support)
                 indices.present_family = i;
@@ -316,11 +553,43 @@ private:
                 break;
         }
 
+        // A compute family without graphics runs on its own hardware queue on most desktop GPUs, otherwise compute shares
+        // the graphics family.
+        for (auto i = 0; i < queue_family_count; i++)
+            if ((queue_families[i].queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queue_families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT))
+            {
+                indices.compute_family = i;
+                break;
+            }
+
+        if (!indices.compute_family.has_value())
+            indices.compute_family = indices.graphics_family;
+
+        // Prefer a transfer-only family (usually the copy engine), then any non-graphics family that can transfer.
+        for (auto i = 0; i < queue_family_count; i++)
+        {
+            const VkQueueFlags flags = queue_families[i].queueFlags;
+
+            if (!(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT) || indices.compute_family == static_cast<uint32_t>(i))
+                continue;
+
+            if (!(flags & VK_QUEUE_COMPUTE_BIT))
+            {
+                indices.transfer_family = i;
+                break;
+            }
+
+            if (!indices.transfer_family.has_value())
+                indices.transfer_family = i;
+        }
+
         return indices;
     }
 
     void create_logical_device()
     {
+        TRACE_FUNCTION();
+
         QueueFamilyIndices indices = find_queue_families(m_physical_device);
 
         std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
@@ -329,6 +598,12 @@ private:
             indices.present_family.value(),
         };
 
+        if (indices.transfer_family.has_value())
+            unique_queue_families.insert(indices.transfer_family.value());
+
+        if (indices.compute_family.has_value())
+            unique_queue_families.insert(indices.compute_family.value());
+
         float queue_priority = 1.0f;
         for (const auto &queue_family : unique_queue_families)
         {
@@ -340,10 +615,31 @@ private:
             queue_create_infos.push_back(queue_create_info);
         }
 
+        VkPhysicalDeviceVulkan12Features supported_vulkan12_features{};
+        supported_vulkan12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+        VkPhysicalDeviceFeatures2 supported_features{};
+        supported_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supported_features.pNext = &supported_vulkan12_features;
+
+        vkGetPhysicalDeviceFeatures2(m_physical_device, &supported_features);
+
+        // Optional, the indirect draw path falls back to what's there.
+        m_indirect_features.draw_indirect_count = supported_vulkan12_features.drawIndirectCount;
+        m_indirect_features.multi_draw_indirect = supported_features.features.multiDrawIndirect;
+
         VkPhysicalDeviceFeatures device_features{};
+        device_features.multiDrawIndirect = supported_features.features.multiDrawIndirect;
+
+        VkPhysicalDeviceVulkan12Features vulkan12_features{};
+        vulkan12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        vulkan12_features.timelineSemaphore = VK_TRUE;
+        vulkan12_features.drawIndirectCount = supported_vulkan12_features.drawIndirectCount;
+        BindlessHeap::enable_features(vulkan12_features);
 
         VkDeviceCreateInfo create_info{};
         create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        create_info.pNext = &vulkan12_features;
         create_info.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size());
         create_info.pQueueCreateInfos = queue_create_infos.data();
         create_info.pEnabledFeatures = &device_features;
@@ -368,10 +664,60 @@ private:
 
         vkGetDeviceQueue(m_device, indices.graphics_family.value(), 0, &m_graphics_queue);
         vkGetDeviceQueue(m_device, indices.present_family.value(), 0, &m_present_queue);
+
+        vkGetDeviceQueue(m_device, indices.compute_family.value(), 0, &m_compute_queue);
+        SPDLOG_INFO("Compute runs on queue family {} ({})", indices.compute_family.value(),
+                    indices.compute_family == indices.graphics_family ? "shared with graphics" : "async");
+
+        if (indices.transfer_family.has_value())
+        {
+            vkGetDeviceQueue(m_device, indices.transfer_family.value(), 0, &m_transfer_queue);
+            SPDLOG_INFO("Uploads use the dedicated transfer queue family {}", indices.transfer_family.value());
+        }
+        else
+        {
+            m_transfer_queue = m_graphics_queue;
+            SPDLOG_INFO("No dedicated transfer queue family, uploads use the graphics queue");
+        }
+    }
+
+    void create_memory_allocator()
+    {
+        TRACE_FUNCTION();
+
+        m_memory_allocator.create(m_physical_device, m_device);
+    }
+
+    void create_pipeline_cache()
+    {
+        TRACE_FUNCTION();
+
+        // Found the same way whatever directory the process was started from.
+        const std::string path = PipelineCache::resolve_path(PIPELINE_CACHE_FILE);
+        m_pipeline_cache.create(m_physical_device, m_device, path);
+
+        if (m_pipeline_cache.is_warm())
+            SPDLOG_INFO("Pipeline cache loaded: {} ({} bytes)", path, m_pipeline_cache.loaded_size());
     }
 
     void create_surface()
     {
+        TRACE_FUNCTION();
+
+        if (m_options.headless == HeadlessMode::offscreen)
+            return;
+
+        if (m_options.headless == HeadlessMode::surface)
+        {
+            VkHeadlessSurfaceCreateInfoEXT create_info{};
+            create_info.sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT;
+
+            if (proxy_vkCreateHeadlessSurfaceEXT(m_instance, &create_info, nullptr, &m_surface) != VK_SUCCESS)
+                throw std::runtime_error("VULKAN_CREATE_SURFACE_FAILURE");
+
+            return;
+        }
+
         if (glfwCreateWindowSurface(m_instance, m_window, nullptr, &m_surface) != VK_SUCCESS)
             throw std::runtime_error("VULKAN_CREATE_SURFACE_FAILURE");
     }
@@ -403,18 +749,23 @@ private:
         std::vector<VkPresentModeKHR> present_modes;
     };
 
-    void create_swapchain()
+    void create_swapchain(VkSwapchainKHR old_swapchain = VK_NULL_HANDLE)
     {
+        TRACE_FUNCTION();
+
+        if (m_options.headless == HeadlessMode::offscreen)
+        {
+            create_offscreen_images();
+            return;
+        }
+
         SwapChainSupportDetails swapchain_support = query_Swap_chain_support(m_physical_device);
 
         VkExtent2D extent = choose_swapchain_extent(swapchain_support.capabilities);
         VkSurfaceFormatKHR surface_format = choose_swapchain_surface_format(swapchain_support.formats);
         VkPresentModeKHR present_mode = choose_swapchain_present_mode(swapchain_support.present_modes);
 
-        uint32_t image_count = swapchain_support.capabilities.minImageCount + 1;
-
-        if (swapchain_support.capabilities.maxImageCount > 0 && image_count > swapchain_support.capabilities.maxImageCount)
-            image_count = swapchain_support.capabilities.maxImageCount;
+        uint32_t image_count = choose_swapchain_image_count(swapchain_support.capabilities, present_mode);
 
         VkSwapchainCreateInfoKHR create_info{};
         create_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -449,11 +800,12 @@ private:
         create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
         create_info.presentMode = present_mode;
         create_info.clipped = VK_TRUE;
-        create_info.oldSwapchain = VK_NULL_HANDLE;
+        create_info.oldSwapchain = old_swapchain;
 
         if (vkCreateSwapchainKHR(m_device, &create_info, nullptr, &m_swapchain) != VK_SUCCESS)
             throw std::runtime_error("VULKAN_CREATE_SWAPCHAIN_FAILURE");
 
+        m_present_mode = present_mode;
         m_swapchain_extent = extent;
         m_swapchain_image_format = surface_format.format;
 
@@ -463,6 +815,56 @@ private:
         vkGetSwapchainImagesKHR(m_device, m_swapchain, &image_count, m_swapchain_images.data());
     }
 
+    void create_offscreen_images()
+    {
+        m_swapchain_image_format = choose_offscreen_image_format();
+        m_swapchain_extent = {WINDOW_WIDTH, WINDOW_HEIGHT};
+
+        // Same count a fifo swapchain would typically give, so frame pacing through m_image_serials matches windowed runs.
+        m_swapchain_images.resize(MAX_FRAMES_IN_FLIGHT + 1);
+        m_offscreen_images.resize(m_swapchain_images.size());
+
+        for (auto i = 0; i < m_swapchain_images.size(); i++)
+        {
+            VkImageCreateInfo create_info{};
+            create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            create_info.imageType = VK_IMAGE_TYPE_2D;
+            create_info.format = m_swapchain_image_format;
+            create_info.extent = {m_swapchain_extent.width, m_swapchain_extent.height, 1};
+            create_info.mipLevels = 1;
+            create_info.arrayLayers = 1;
+            create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+            create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+            create_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+            create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            m_offscreen_images[i] = m_memory_allocator.create_image(create_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            m_swapchain_images[i] = m_offscreen_images[i].image;
+        }
+    }
+
+    VkFormat choose_offscreen_image_format()
+    {
+        const VkFormat candidate_formats[] = {
+            VK_FORMAT_B8G8R8A8_SRGB,
+            VK_FORMAT_R8G8B8A8_SRGB,
+            VK_FORMAT_B8G8R8A8_UNORM,
+            VK_FORMAT_R8G8B8A8_UNORM,
+        };
+
+        for (const auto &format : candidate_formats)
+        {
+            VkFormatProperties format_properties;
+            vkGetPhysicalDeviceFormatProperties(m_physical_device, format, &format_properties);
+
+            if (format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT)
+                return format;
+        }
+
+        throw std::runtime_error("VULKAN_OFFSCREEN_FORMAT_NOT_SUPPORTED");
+    }
+
     SwapChainSupportDetails query_Swap_chain_support(VkPhysicalDevice device)
     {
         SwapChainSupportDetails details;
@@ -496,8 +898,9 @@ private:
             return capabilities.currentExtent;
         else
         {
-            int width, height;
-            glfwGetFramebufferSize(m_window, &width, &height);
+            int width = WINDOW_WIDTH, height = WINDOW_HEIGHT;
+            if (m_window)
+                glfwGetFramebufferSize(m_window, &width, &height);
 
             VkExtent2D actualExtent = {
                 static_cast<uint32_t>(width),
@@ -522,15 +925,84 @@ private:
 
     VkPresentModeKHR choose_swapchain_present_mode(const std::vector<VkPresentModeKHR> &available_present_modes)
     {
-        // for (const auto &available_present_mode : available_present_modes)
-        //     if (available_present_mode == VK_PRESENT_MODE_MAILBOX_KHR)
-        //         return available_present_mode;
+        std::vector<VkPresentModeKHR> preferred_present_modes;
+
+        switch (m_options.present_policy)
+        {
+        case PresentPolicy::low_latency:
+            preferred_present_modes = {VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR};
+            break;
+        case PresentPolicy::uncapped:
+            preferred_present_modes = {VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR};
+            break;
+        case PresentPolicy::relaxed:
+            preferred_present_modes = {VK_PRESENT_MODE_FIFO_RELAXED_KHR};
+            break;
+        default:
+            break;
+        }
+
+        for (const auto &preferred_present_mode : preferred_present_modes)
+            if (std::find(available_present_modes.cbegin(), available_present_modes.cend(), preferred_present_mode) != available_present_modes.cend())
+            {
+                SPDLOG_TRACE("Present mode: {}", present_mode_name(preferred_present_mode));
+                return preferred_present_mode;
+            }
 
+        // FIFO is the only mode every surface is required to support.
+        SPDLOG_TRACE("Present mode: {}", present_mode_name(VK_PRESENT_MODE_FIFO_KHR));
         return VK_PRESENT_MODE_FIFO_KHR;
     }
 
+    uint32_t choose_swapchain_image_count(const VkSurfaceCapabilitiesKHR &capabilities, VkPresentModeKHR present_mode)
+    {
+        uint32_t image_count;
+
+        switch (present_mode)
+        {
+        case VK_PRESENT_MODE_MAILBOX_KHR:
+            // One image on screen, one queued and one to render into, otherwise mailbox degrades to fifo.
+            image_count = std::max(capabilities.minImageCount + 1, 3u);
+            break;
+        case VK_PRESENT_MODE_IMMEDIATE_KHR:
+            // Nothing is ever queued, so extra images only add memory.
+            image_count = std::max(capabilities.minImageCount, 2u);
+            break;
+        default:
+            // Fifo blocks on acquire when every image is queued, one spare image keeps the CPU from stalling.
+            image_count = capabilities.minImageCount + 1;
+            break;
+        }
+
+        if (capabilities.maxImageCount > 0 && image_count > capabilities.maxImageCount)
+            image_count = capabilities.maxImageCount;
+
+        SPDLOG_TRACE("Swapchain image count: {} (min {}, max {})", image_count, capabilities.minImageCount, capabilities.maxImageCount);
+
+        return image_count;
+    }
+
+    static const char *present_mode_name(VkPresentModeKHR present_mode)
+    {
+        switch (present_mode)
+        {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR:
+            return "immediate";
+        case VK_PRESENT_MODE_MAILBOX_KHR:
+            return "mailbox";
+        case VK_PRESENT_MODE_FIFO_KHR:
+            return "fifo";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+            return "fifo relaxed";
+        default:
+            return "unknown";
+        }
+    }
+
     void create_image_views()
     {
+        TRACE_FUNCTION();
+
         m_swapchain_image_views.resize(m_swapchain_images.size());
 
         for (auto i = 0; i < m_swapchain_images.size(); i++)
@@ -557,6 +1029,8 @@ private:
 
     void create_render_pass()
     {
+        TRACE_FUNCTION();
+
         VkAttachmentDescription color_attachment{};
         color_attachment.format = m_swapchain_image_format;
         color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -565,7 +1039,7 @@ private:
         color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        color_attachment.finalLayout = m_options.headless == HeadlessMode::offscreen ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
         VkAttachmentReference color_attachment_ref{};
         color_attachment_ref.attachment = 0;
@@ -597,10 +1071,41 @@ private:
             throw std::runtime_error("VULKAN_CREATE_RENDER_PASS_FAILURE");
     }
 
+    // Per draw, matches the push constants of shader.vert and shader.frag.
+    struct GraphicsPushConstants
+    {
+        glm::mat4 model;
+        uint32_t material_buffer;
+    };
+
+    // Per frame, matches the std140 FrameUniforms block of shader.vert.
+    struct FrameUniforms
+    {
+        glm::mat4 view_projection;
+        float time;
+        float padding[3];
+    };
+
+    void create_bindless_heap()
+    {
+        TRACE_FUNCTION();
+
+        m_bindless_heap.create(m_physical_device, m_device, BINDLESS_IMAGE_CAPACITY, BINDLESS_BUFFER_CAPACITY);
+    }
+
+    // SPIR-V words and their size in bytes, borrowed from the embedded arrays or a hot reloaded copy.
+    struct ShaderCode
+    {
+        const uint32_t *code;
+        size_t size;
+    };
+
     void create_graphics_pipeline()
     {
-        auto vertex_shader_code = read_file(SHADER_BINARY_DIRECTORY "/shader.vert.spv");
-        auto fragment_shader_code = read_file(SHADER_BINARY_DIRECTORY "/shader.frag.spv");
+        TRACE_FUNCTION();
+
+        auto vertex_shader_code = load_shader("shader.vert");
+        auto fragment_shader_code = load_shader("shader.frag");
 
         VkShaderModule vertex_shader_module = create_shader_module(vertex_shader_code);
         VkShaderModule fragment_shader_module = create_shader_module(fragment_shader_code);
@@ -622,36 +1127,48 @@ private:
             fragment_shader_create_info,
         };
 
+        auto binding_descriptions = Mesh::binding_descriptions(m_options.vertex_layout);
+        auto attribute_descriptions = Mesh::attribute_descriptions(m_options.vertex_layout);
+
+        // The compute pass writes one tint per vertex, bound after the mesh's own streams.
+        const uint32_t tint_binding = static_cast<uint32_t>(binding_descriptions.size());
+        binding_descriptions.push_back({tint_binding, 4 * sizeof(float), VK_VERTEX_INPUT_RATE_VERTEX});
+        attribute_descriptions.push_back({2, tint_binding, VK_FORMAT_R32G32B32A32_SFLOAT, 0});
+
+        // Instance attributes follow the tints, every scene draws through them with a single identity instance at least.
+        const uint32_t instance_binding = tint_binding + 1;
+        auto instance_attributes = InstanceBuffer::attribute_descriptions(instance_binding, 3);
+        binding_descriptions.push_back(InstanceBuffer::binding_description(instance_binding));
+        attribute_descriptions.insert(attribute_descriptions.end(), instance_attributes.begin(), instance_attributes.end());
+
         VkPipelineVertexInputStateCreateInfo vertex_input_create_info{};
         vertex_input_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertex_input_create_info.vertexBindingDescriptionCount = 0;
-        vertex_input_create_info.pVertexBindingDescriptions = nullptr;
-        vertex_input_create_info.vertexAttributeDescriptionCount = 0;
-        vertex_input_create_info.pVertexAttributeDescriptions = nullptr;
+        vertex_input_create_info.vertexBindingDescriptionCount = static_cast<uint32_t>(binding_descriptions.size());
+        vertex_input_create_info.pVertexBindingDescriptions = binding_descriptions.data();
+        vertex_input_create_info.vertexAttributeDescriptionCount = static_cast<uint32_t>(attribute_descriptions.size());
+        vertex_input_create_info.pVertexAttributeDescriptions = attribute_descriptions.data();
 
         VkPipelineInputAssemblyStateCreateInfo input_assembly_create_info{};
         input_assembly_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
         input_assembly_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
         input_assembly_create_info.primitiveRestartEnable = VK_FALSE;
 
-        VkViewport viewport{};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = (float)m_swapchain_extent.width;
-        viewport.height = (float)m_swapchain_extent.height;
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-
-        VkRect2D scissor{};
-        scissor.offset = {0, 0};
-        scissor.extent = m_swapchain_extent;
-
         VkPipelineViewportStateCreateInfo viewport_create_info{};
         viewport_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
         viewport_create_info.viewportCount = 1;
-        viewport_create_info.pViewports = &viewport;
+        viewport_create_info.pViewports = nullptr;
         viewport_create_info.scissorCount = 1;
-        viewport_create_info.pScissors = &scissor;
+        viewport_create_info.pScissors = nullptr;
+
+        VkDynamicState dynamic_states[] = {
+            VK_DYNAMIC_STATE_VIEWPORT,
+            VK_DYNAMIC_STATE_SCISSOR,
+        };
+
+        VkPipelineDynamicStateCreateInfo dynamic_state_create_info{};
+        dynamic_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamic_state_create_info.dynamicStateCount = 2;
+        dynamic_state_create_info.pDynamicStates = dynamic_states;
 
         VkPipelineRasterizationStateCreateInfo rasterization_create_info{};
         rasterization_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -690,12 +1207,21 @@ private:
         color_blending_create_info.blendConstants[2] = 0.0f;
         color_blending_create_info.blendConstants[3] = 0.0f;
 
+        // Textures and materials come out of the bindless set, per draw push constants carry the model matrix and say
+        // which slots, and per frame uniforms sit at a dynamic offset into the uniform ring.
+        VkPushConstantRange push_constant_range{};
+        push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+        push_constant_range.offset = 0;
+        push_constant_range.size = sizeof(GraphicsPushConstants);
+
+        VkDescriptorSetLayout set_layouts[] = {m_bindless_heap.set_layout(), m_uniform_ring.set_layout()};
+
         VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
         pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = 0;
-        pipelineLayoutInfo.pSetLayouts = nullptr;
-        pipelineLayoutInfo.pushConstantRangeCount = 0;
-        pipelineLayoutInfo.pPushConstantRanges = nullptr;
+        pipelineLayoutInfo.setLayoutCount = 2;
+        pipelineLayoutInfo.pSetLayouts = set_layouts;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &push_constant_range;
 
         if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipeline_layout) != VK_SUCCESS)
             throw std::runtime_error("VULKAN_CREATE_PIPELINE_LAYOUT_FAILURE");
@@ -711,140 +1237,539 @@ private:
         pipeline_create_info.pMultisampleState = &multisample_create_info;
         pipeline_create_info.pDepthStencilState = nullptr;
         pipeline_create_info.pColorBlendState = &color_blending_create_info;
-        pipeline_create_info.pDynamicState = nullptr;
+        pipeline_create_info.pDynamicState = &dynamic_state_create_info;
         pipeline_create_info.layout = m_pipeline_layout;
         pipeline_create_info.renderPass = m_render_pass;
         pipeline_create_info.subpass = 0;
         pipeline_create_info.basePipelineHandle = VK_NULL_HANDLE;
         pipeline_create_info.basePipelineIndex = -1;
 
-        if (vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipeline_create_info, nullptr, &m_graphics_pipeline) != VK_SUCCESS)
+        auto pipeline_start = std::chrono::steady_clock::now();
+
+        if (vkCreateGraphicsPipelines(m_device, m_pipeline_cache.handle(), 1, &pipeline_create_info, nullptr, &m_graphics_pipeline) != VK_SUCCESS)
             throw std::runtime_error("VULKAN_CREATE_GRAPHICS_PIPELINE_FAILURE");
 
+        std::chrono::duration<double, std::milli> pipeline_duration = std::chrono::steady_clock::now() - pipeline_start;
+        SPDLOG_TRACE("Graphics pipeline created in {:.3f} ms", pipeline_duration.count());
+
         vkDestroyShaderModule(m_device, vertex_shader_module, nullptr);
         vkDestroyShaderModule(m_device, fragment_shader_module, nullptr);
     }
 
-    VkShaderModule create_shader_module(const std::vector<char> &shader_code)
+    struct TintPushConstants
     {
-        VkShaderModuleCreateInfo create_info{};
-        create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        create_info.codeSize = shader_code.size();
-        create_info.pCode = reinterpret_cast<const uint32_t *>(shader_code.data());
-
-        VkShaderModule shader_module;
-        if (vkCreateShaderModule(m_device, &create_info, nullptr, &shader_module) != VK_SUCCESS)
-            throw std::runtime_error("VULKAN_CREATE_SHADER_MODULE_FAILURE");
+        float time;
+        uint32_t vertex_count;
+    };
 
-        return shader_module;
-    }
+    // Matches local_size_x in tint.comp.
+    static constexpr uint32_t TINT_WORKGROUP_SIZE = 64;
 
-    void create_framebuffers()
+    void create_compute_pipeline()
     {
-        m_swapchain_framebuffers.resize(m_swapchain_image_views.size());
-
-        for (auto i = 0; i < m_swapchain_image_views.size(); i++)
-        {
-            VkImageView attachments[] = {
-                m_swapchain_image_views[i],
-            };
-
-            VkFramebufferCreateInfo framebuffer_create_info{};
-            framebuffer_create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-            framebuffer_create_info.renderPass = m_render_pass;
-            framebuffer_create_info.attachmentCount = 1;
-            framebuffer_create_info.pAttachments = attachments;
-            framebuffer_create_info.width = m_swapchain_extent.width;
-            framebuffer_create_info.height = m_swapchain_extent.height;
-            framebuffer_create_info.layers = 1;
+        TRACE_FUNCTION();
+
+        VkDescriptorSetLayoutBinding tint_binding{};
+        tint_binding.binding = 0;
+        tint_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        tint_binding.descriptorCount = 1;
+        tint_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info{};
+        descriptor_set_layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        descriptor_set_layout_create_info.bindingCount = 1;
+        descriptor_set_layout_create_info.pBindings = &tint_binding;
+
+        if (vkCreateDescriptorSetLayout(m_device, &descriptor_set_layout_create_info, nullptr, &m_compute_descriptor_set_layout) != VK_SUCCESS)
+            throw std::runtime_error("VULKAN_CREATE_DESCRIPTOR_SET_LAYOUT_FAILURE");
+
+        VkPushConstantRange push_constant_range{};
+        push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        push_constant_range.offset = 0;
+        push_constant_range.size = sizeof(TintPushConstants);
+
+        VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
+        pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipeline_layout_create_info.setLayoutCount = 1;
+        pipeline_layout_create_info.pSetLayouts = &m_compute_descriptor_set_layout;
+        pipeline_layout_create_info.pushConstantRangeCount = 1;
+        pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+
+        if (vkCreatePipelineLayout(m_device, &pipeline_layout_create_info, nullptr, &m_compute_pipeline_layout) != VK_SUCCESS)
+            throw std::runtime_error("VULKAN_CREATE_PIPELINE_LAYOUT_FAILURE");
 
-            if (vkCreateFramebuffer(m_device, &framebuffer_create_info, nullptr, &m_swapchain_framebuffers[i]) != VK_SUCCESS)
-                throw std::runtime_error("VULKAN_CREATE_FRAMEBUFFER_FAILURE");
-        }
-    }
+        create_tint_pipeline();
 
-    void create_command_pool()
-    {
         QueueFamilyIndices queue_family_indices = find_queue_families(m_physical_device);
 
         VkCommandPoolCreateInfo pool_create_info{};
         pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-        pool_create_info.queueFamilyIndex = queue_family_indices.graphics_family.value();
-        pool_create_info.flags = 0;
+        pool_create_info.queueFamilyIndex = queue_family_indices.compute_family.value();
+        pool_create_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
-        if (vkCreateCommandPool(m_device, &pool_create_info, nullptr, &m_command_pool) != VK_SUCCESS)
+        if (vkCreateCommandPool(m_device, &pool_create_info, nullptr, &m_compute_command_pool) != VK_SUCCESS)
             throw std::runtime_error("VULKAN_CREATE_COMMAND_POOL_FAILURE");
-    }
 
-    void create_command_buffers()
-    {
-        m_command_buffers.resize(m_swapchain_framebuffers.size());
+        m_compute_command_buffers.resize(MAX_FRAMES_IN_FLIGHT);
 
         VkCommandBufferAllocateInfo command_buffer_allocate_info{};
         command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        command_buffer_allocate_info.commandPool = m_command_pool;
+        command_buffer_allocate_info.commandPool = m_compute_command_pool;
         command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        command_buffer_allocate_info.commandBufferCount = (uint32_t)m_command_buffers.size();
+        command_buffer_allocate_info.commandBufferCount = (uint32_t)m_compute_command_buffers.size();
 
-        if (vkAllocateCommandBuffers(m_device, &command_buffer_allocate_info, m_command_buffers.data()) != VK_SUCCESS)
+        if (vkAllocateCommandBuffers(m_device, &command_buffer_allocate_info, m_compute_command_buffers.data()) != VK_SUCCESS)
             throw std::runtime_error("VULKAN_ALLOCATE_COMMAND_BUFFERS_FAILURE");
-
-        for (auto i = 0; i < m_command_buffers.size(); i++)
-        {
-            VkCommandBufferBeginInfo command_buffer_begin_info{};
-            command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-
-            if (vkBeginCommandBuffer(m_command_buffers[i], &command_buffer_begin_info) != VK_SUCCESS)
-                throw std::runtime_error("VULKAN_BEGIN_COMMAND_BUFFER_FAILURE");
-
-            VkRenderPassBeginInfo render_pass_begin_info{};
-            render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            render_pass_begin_info.renderPass = m_render_pass;
-            render_pass_begin_info.framebuffer = m_swapchain_framebuffers[i];
-            render_pass_begin_info.renderArea.offset = {0, 0};
-            render_pass_begin_info.renderArea.extent = m_swapchain_extent;
-
-            VkClearValue clear_color = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
-            render_pass_begin_info.clearValueCount = 1;
-            render_pass_begin_info.pClearValues = &clear_color;
-
-            vkCmdBeginRenderPass(m_command_buffers[i], &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
-            vkCmdBindPipeline(m_command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphics_pipeline);
-            vkCmdDraw(m_command_buffers[i], 3, 1, 0, 0);
-            vkCmdEndRenderPass(m_command_buffers[i]);
-
-            if (vkEndCommandBuffer(m_command_buffers[i]) != VK_SUCCESS)
-                throw std::runtime_error("VULKAN_END_COMMAND_BUFFER_FAILURE");
-        }
+    }
+
+    // Only the pipeline, so a reloaded tint.comp can replace it while the layout stays.
+    void create_tint_pipeline()
+    {
+        VkShaderModule compute_shader_module = create_shader_module(load_shader("tint.comp"));
+
+        VkComputePipelineCreateInfo pipeline_create_info{};
+        pipeline_create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipeline_create_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipeline_create_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipeline_create_info.stage.module = compute_shader_module;
+        pipeline_create_info.stage.pName = "main";
+        pipeline_create_info.layout = m_compute_pipeline_layout;
+
+        if (vkCreateComputePipelines(m_device, m_pipeline_cache.handle(), 1, &pipeline_create_info, nullptr, &m_compute_pipeline) != VK_SUCCESS)
+            throw std::runtime_error("VULKAN_CREATE_COMPUTE_PIPELINE_FAILURE");
+
+        vkDestroyShaderModule(m_device, compute_shader_module, nullptr);
+    }
+
+    void create_tint_buffers()
+    {
+        TRACE_FUNCTION();
+
+        // Each frame in flight reads its own tint buffer, so the compute pass for a frame never overwrites tints an
+        // earlier frame is still drawing with.
+        const uint32_t frame_count = MAX_FRAMES_IN_FLIGHT;
+
+        QueueFamilyIndices queue_family_indices = find_queue_families(m_physical_device);
+        std::vector<uint32_t> queue_families = {queue_family_indices.graphics_family.value()};
+
+        // Concurrent sharing spares the per-frame ownership transfers between the compute and graphics families.
+        if (queue_family_indices.compute_family != queue_family_indices.graphics_family)
+            queue_families.push_back(queue_family_indices.compute_family.value());
+
+        m_tint_buffers.resize(frame_count);
+        for (auto &tint_buffer : m_tint_buffers)
+            tint_buffer = m_memory_allocator.create_buffer(m_mesh.vertex_count() * 4 * sizeof(float), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, queue_families);
+    }
+
+    void create_indirect_draws()
+    {
+        if (m_options.draw_path != DrawPath::indirect)
+            return;
+
+        TRACE_FUNCTION();
+
+        QueueFamilyIndices queue_family_indices = find_queue_families(m_physical_device);
+        std::vector<uint32_t> queue_families = {queue_family_indices.graphics_family.value()};
+
+        if (queue_family_indices.compute_family != queue_family_indices.graphics_family)
+            queue_families.push_back(queue_family_indices.compute_family.value());
+
+        const ShaderCode shader_code = load_shader("draw_commands.comp");
+
+        m_indirect_draws.create(m_memory_allocator, m_device, m_pipeline_cache.handle(), m_descriptor_cache, shader_code.code, shader_code.size,
+                                m_draw_ranges, m_draw_bounds, m_mesh_bounds, m_instance_buffer.instance_count(), queue_families, MAX_FRAMES_IN_FLIGHT,
+                                m_indirect_features);
+    }
+
+    VkShaderModule create_shader_module(const ShaderCode &shader_code)
+    {
+        VkShaderModuleCreateInfo create_info{};
+        create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        create_info.codeSize = shader_code.size;
+        create_info.pCode = shader_code.code;
+
+        VkShaderModule shader_module;
+        if (vkCreateShaderModule(m_device, &create_info, nullptr, &shader_module) != VK_SUCCESS)
+            throw std::runtime_error("VULKAN_CREATE_SHADER_MODULE_FAILURE");
+
+        return shader_module;
+    }
+
+    void create_framebuffers()
+    {
+        TRACE_FUNCTION();
+
+        m_swapchain_framebuffers.resize(m_swapchain_image_views.size());
+
+        for (auto i = 0; i < m_swapchain_image_views.size(); i++)
+        {
+            VkImageView attachments[] = {
+                m_swapchain_image_views[i],
+            };
+
+            VkFramebufferCreateInfo framebuffer_create_info{};
+            framebuffer_create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebuffer_create_info.renderPass = m_render_pass;
+            framebuffer_create_info.attachmentCount = 1;
+            framebuffer_create_info.pAttachments = attachments;
+            framebuffer_create_info.width = m_swapchain_extent.width;
+            framebuffer_create_info.height = m_swapchain_extent.height;
+            framebuffer_create_info.layers = 1;
+
+            if (vkCreateFramebuffer(m_device, &framebuffer_create_info, nullptr, &m_swapchain_framebuffers[i]) != VK_SUCCESS)
+                throw std::runtime_error("VULKAN_CREATE_FRAMEBUFFER_FAILURE");
+        }
+    }
+
+    void create_command_pools()
+    {
+        TRACE_FUNCTION();
+
+        QueueFamilyIndices queue_family_indices = find_queue_families(m_physical_device);
+
+        // Nothing recorded from these pools outlives its frame, so they're reset wholesale instead of buffer by buffer.
+        VkCommandPoolCreateInfo pool_create_info{};
+        pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        pool_create_info.queueFamilyIndex = queue_family_indices.graphics_family.value();
+        pool_create_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+        m_frame_commands.resize(MAX_FRAMES_IN_FLIGHT);
+
+        for (auto &frame_commands : m_frame_commands)
+        {
+            if (vkCreateCommandPool(m_device, &pool_create_info, nullptr, &frame_commands.command_pool) != VK_SUCCESS)
+                throw std::runtime_error("VULKAN_CREATE_COMMAND_POOL_FAILURE");
+
+            VkCommandBufferAllocateInfo command_buffer_allocate_info{};
+            command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            command_buffer_allocate_info.commandPool = frame_commands.command_pool;
+            command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            command_buffer_allocate_info.commandBufferCount = 2;
+
+            VkCommandBuffer command_buffers[2];
+            if (vkAllocateCommandBuffers(m_device, &command_buffer_allocate_info, command_buffers) != VK_SUCCESS)
+                throw std::runtime_error("VULKAN_ALLOCATE_COMMAND_BUFFERS_FAILURE");
+
+            frame_commands.command_buffer = command_buffers[0];
+            frame_commands.upload_command_buffer = command_buffers[1];
+
+            // Command pools are externally synchronised, so every thread that runs jobs records into a pool of its own.
+            frame_commands.threads.resize(m_job_system.thread_count());
+            for (auto &thread_commands : frame_commands.threads)
+                if (vkCreateCommandPool(m_device, &pool_create_info, nullptr, &thread_commands.command_pool) != VK_SUCCESS)
+                    throw std::runtime_error("VULKAN_CREATE_COMMAND_POOL_FAILURE");
+        }
+    }
+
+    void create_staging_ring()
+    {
+        TRACE_FUNCTION();
+
+        m_staging_ring.create(m_memory_allocator, m_device, STAGING_RING_FRAME_SIZE, MAX_FRAMES_IN_FLIGHT);
+    }
+
+    void create_descriptor_allocators()
+    {
+        TRACE_FUNCTION();
+
+        m_frame_descriptors.create(m_device, MAX_FRAMES_IN_FLIGHT);
+        m_descriptor_cache.create(m_device);
+    }
+
+    void create_uniform_ring()
+    {
+        TRACE_FUNCTION();
+
+        m_uniform_ring.create(m_memory_allocator, m_physical_device, m_device, m_descriptor_cache, UNIFORM_RING_FRAME_SIZE, sizeof(FrameUniforms), MAX_FRAMES_IN_FLIGHT);
+    }
+
+    void create_upload_scheduler()
+    {
+        TRACE_FUNCTION();
+
+        QueueFamilyIndices queue_family_indices = find_queue_families(m_physical_device);
+
+        m_upload_scheduler.create(m_memory_allocator, m_device, m_transfer_queue,
+                                  queue_family_indices.transfer_family.value_or(queue_family_indices.graphics_family.value()),
+                                  queue_family_indices.graphics_family.value());
+    }
+
+    void create_materials()
+    {
+        TRACE_FUNCTION();
+
+        // Uploaded with the first frame's ring copies.
+        m_materials.create(m_memory_allocator, m_device, m_staging_ring, m_bindless_heap);
+    }
+
+    void create_instance_buffer()
+    {
+        TRACE_FUNCTION();
+
+        const uint32_t instance_count = m_options.scene == Scene::instances ? m_options.instances : 1;
+        m_instance_buffer.create(m_memory_allocator, instance_count, m_materials.material_count(), MAX_FRAMES_IN_FLIGHT);
+    }
+
+    void create_mesh()
+    {
+        TRACE_FUNCTION();
+
+        MeshData mesh_data = m_options.scene == Scene::grid ? make_grid_mesh(m_options.triangles, m_job_system) : make_triangle_mesh();
+
+        m_mesh.create(m_memory_allocator, m_staging_ring, m_upload_scheduler, mesh_data, m_options.vertex_layout);
+        m_draw_ranges = m_mesh.draw_ranges(m_options.draws);
+
+        // Only the GPU culling pass looks at bounds. It culls every instance with the box around the whole mesh, and a
+        // draw with the box around everywhere its range can end up.
+        if (m_options.draw_path == DrawPath::indirect)
+        {
+            m_draw_bounds = compute_draw_bounds(mesh_data, m_draw_ranges, m_job_system);
+            m_mesh_bounds = m_draw_bounds.front();
+
+            for (auto &bounds : m_draw_bounds)
+            {
+                m_mesh_bounds = {glm::min(m_mesh_bounds.min, bounds.min), glm::max(m_mesh_bounds.max, bounds.max)};
+                bounds = m_instance_buffer.bounds(bounds);
+            }
+        }
+    }
+
+    void create_gpu_profiler()
+    {
+        TRACE_FUNCTION();
+
+        QueueFamilyIndices queue_family_indices = find_queue_families(m_physical_device);
+
+        // Command buffers are recorded per frame in flight, so each frame gets its own set of queries.
+        m_gpu_profiler.create(m_physical_device, m_device, queue_family_indices.graphics_family.value(), MAX_FRAMES_IN_FLIGHT);
+
+        m_gpu_zone_frame = m_gpu_profiler.register_zone("frame");
+        m_gpu_zone_render_pass = m_gpu_profiler.register_zone("render pass");
+        m_gpu_zone_draw = m_gpu_profiler.register_zone("draw");
+    }
+
+    void create_job_system()
+    {
+        TRACE_FUNCTION();
+
+        uint32_t worker_count = m_options.worker_threads;
+        if (worker_count == 0)
+            worker_count = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+        m_job_system.create(worker_count);
+
+        SPDLOG_INFO("Job system running {} worker threads next to the main thread", worker_count);
+    }
+
+    void record_command_buffer(uint32_t image_index)
+    {
+        TRACE_FUNCTION();
+
+        FrameCommands &frame_commands = m_frame_commands[m_current_frame];
+
+        // The frame's previous submission has retired, so nothing recorded from its pools can still be pending.
+        vkResetCommandPool(m_device, frame_commands.command_pool, 0);
+        for (auto &thread_commands : frame_commands.threads)
+        {
+            vkResetCommandPool(m_device, thread_commands.command_pool, 0);
+            thread_commands.used = 0;
+        }
+
+        // The draw list is cut into one slice per thread, each recorded into its own secondary command buffer. Indirect
+        // draws are a single call whatever the object count, so they don't need cutting.
+        const uint32_t slice_count = m_options.draw_path == DrawPath::indirect ? 1 : std::min(m_job_system.thread_count(), static_cast<uint32_t>(m_draw_ranges.size()));
+
+        m_secondary_command_buffers.resize(slice_count);
+        m_job_system.parallel_for(slice_count, 1, [this, image_index, slice_count](uint32_t thread, uint32_t slice)
+                                  { m_secondary_command_buffers[slice] = record_secondary_command_buffer(thread, image_index, slice, slice_count); });
+
+        VkCommandBuffer command_buffer = frame_commands.command_buffer;
+
+        VkCommandBufferBeginInfo command_buffer_begin_info{};
+        command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (vkBeginCommandBuffer(command_buffer, &command_buffer_begin_info) != VK_SUCCESS)
+            throw std::runtime_error("VULKAN_BEGIN_COMMAND_BUFFER_FAILURE");
+
+        m_gpu_profiler.begin_slot(command_buffer, m_current_frame);
+        m_gpu_profiler.begin_zone(command_buffer, m_current_frame, m_gpu_zone_frame);
+
+        VkRenderPassBeginInfo render_pass_begin_info{};
+        render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        render_pass_begin_info.renderPass = m_render_pass;
+        render_pass_begin_info.framebuffer = m_swapchain_framebuffers[image_index];
+        render_pass_begin_info.renderArea.offset = {0, 0};
+        render_pass_begin_info.renderArea.extent = m_swapchain_extent;
+
+        VkClearValue clear_color = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
+        render_pass_begin_info.clearValueCount = 1;
+        render_pass_begin_info.pClearValues = &clear_color;
+
+        m_gpu_profiler.begin_zone(command_buffer, m_current_frame, m_gpu_zone_render_pass);
+        vkCmdBeginRenderPass(command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+        vkCmdExecuteCommands(command_buffer, static_cast<uint32_t>(m_secondary_command_buffers.size()), m_secondary_command_buffers.data());
+
+        vkCmdEndRenderPass(command_buffer);
+        m_gpu_profiler.end_zone(command_buffer, m_current_frame, m_gpu_zone_render_pass);
+        m_gpu_profiler.end_zone(command_buffer, m_current_frame, m_gpu_zone_frame);
+
+        if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+            throw std::runtime_error("VULKAN_END_COMMAND_BUFFER_FAILURE");
+    }
+
+    VkCommandBuffer record_secondary_command_buffer(uint32_t thread, uint32_t image_index, uint32_t slice, uint32_t slice_count)
+    {
+        ThreadCommands &thread_commands = m_frame_commands[m_current_frame].threads[thread];
+
+        // Resetting a pool keeps its command buffers allocated, so they're handed out again and only topped up when a
+        // thread picks up more slices than it ever did before.
+        if (thread_commands.used == thread_commands.command_buffers.size())
+        {
+            VkCommandBufferAllocateInfo command_buffer_allocate_info{};
+            command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            command_buffer_allocate_info.commandPool = thread_commands.command_pool;
+            command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            command_buffer_allocate_info.commandBufferCount = 1;
+
+            VkCommandBuffer command_buffer;
+            if (vkAllocateCommandBuffers(m_device, &command_buffer_allocate_info, &command_buffer) != VK_SUCCESS)
+                throw std::runtime_error("VULKAN_ALLOCATE_COMMAND_BUFFERS_FAILURE");
+
+            thread_commands.command_buffers.push_back(command_buffer);
+        }
+
+        VkCommandBuffer command_buffer = thread_commands.command_buffers[thread_commands.used++];
+
+        VkCommandBufferInheritanceInfo inheritance_info{};
+        inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritance_info.renderPass = m_render_pass;
+        inheritance_info.subpass = 0;
+        inheritance_info.framebuffer = m_swapchain_framebuffers[image_index];
+
+        VkCommandBufferBeginInfo command_buffer_begin_info{};
+        command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        command_buffer_begin_info.pInheritanceInfo = &inheritance_info;
+
+        if (vkBeginCommandBuffer(command_buffer, &command_buffer_begin_info) != VK_SUCCESS)
+            throw std::runtime_error("VULKAN_BEGIN_COMMAND_BUFFER_FAILURE");
+
+        // Secondaries inherit no state from the primary, so each one binds everything it draws with.
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphics_pipeline);
+
+        m_bindless_heap.bind(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout);
+        m_uniform_ring.bind(command_buffer, m_pipeline_layout, 1, m_frame_uniform_offset);
+
+        // Every range of the mesh shares its model matrix and material table, so one push covers all of a slice's draws.
+        GraphicsPushConstants push_constants{};
+        push_constants.model = glm::mat4(1.0f);
+        push_constants.material_buffer = m_materials.buffer_slot();
+        vkCmdPushConstants(command_buffer, m_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(push_constants), &push_constants);
+
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = (float)m_swapchain_extent.width;
+        viewport.height = (float)m_swapchain_extent.height;
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+
+        VkRect2D scissor{};
+        scissor.offset = {0, 0};
+        scissor.extent = m_swapchain_extent;
+        vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+
+        VkDeviceSize tint_offset = 0;
+        m_mesh.bind(command_buffer);
+        vkCmdBindVertexBuffers(command_buffer, m_mesh.binding_count(), 1, &m_tint_buffers[m_current_frame].buffer, &tint_offset);
+
+        // The indirect draws only see the instances their culling pass kept.
+        if (m_options.draw_path == DrawPath::indirect)
+            m_indirect_draws.bind_instances(command_buffer, m_mesh.binding_count() + 1, m_current_frame);
+        else
+            m_instance_buffer.bind(command_buffer, m_mesh.binding_count() + 1, m_current_frame);
+
+        // Timestamps aren't allowed in the primary between secondaries, so the first and last slice bracket the draws.
+        if (slice == 0)
+            m_gpu_profiler.begin_zone(command_buffer, m_current_frame, m_gpu_zone_draw);
+
+        if (m_options.draw_path == DrawPath::indirect)
+            m_indirect_draws.draw(command_buffer, m_current_frame);
+        else
+        {
+            const size_t first_range = m_draw_ranges.size() * slice / slice_count;
+            const size_t last_range = m_draw_ranges.size() * (slice + 1) / slice_count;
+
+            for (size_t i = first_range; i < last_range; i++)
+                m_mesh.draw(command_buffer, m_draw_ranges[i], m_instance_buffer.instance_count());
+        }
+
+        if (slice == slice_count - 1)
+            m_gpu_profiler.end_zone(command_buffer, m_current_frame, m_gpu_zone_draw);
+
+        if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+            throw std::runtime_error("VULKAN_END_COMMAND_BUFFER_FAILURE");
+
+        return command_buffer;
     }
 
     void create_sync_objects()
     {
+        TRACE_FUNCTION();
+
         m_image_available_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
         m_render_finished_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        m_in_flight_fences.resize(MAX_FRAMES_IN_FLIGHT);
-        m_images_in_flight.resize(m_swapchain_images.size(), VK_NULL_HANDLE);
+        m_image_serials.resize(m_swapchain_images.size(), 0);
 
+        // The presentation engine only takes binary semaphores, everything else waits on a queue's timeline. Both
+        // timelines count frame serials, a frame signals its serial on each queue it runs on.
         VkSemaphoreCreateInfo semaphore_create_info{};
         semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-        VkFenceCreateInfo fence_create_info{};
-        fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fence_create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
         for (auto i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
             if (vkCreateSemaphore(m_device, &semaphore_create_info, nullptr, &m_image_available_semaphores[i]) != VK_SUCCESS ||
-                vkCreateSemaphore(m_device, &semaphore_create_info, nullptr, &m_render_finished_semaphores[i]) != VK_SUCCESS ||
-                vkCreateFence(m_device, &fence_create_info, nullptr, &m_in_flight_fences[i]) != VK_SUCCESS)
+                vkCreateSemaphore(m_device, &semaphore_create_info, nullptr, &m_render_finished_semaphores[i]) != VK_SUCCESS)
                 throw std::runtime_error("VULKAN_CREATE_SYNCHRONIZATION_OBJECTS_FAILURE");
+
+        VkSemaphoreTypeCreateInfo semaphore_type_create_info{};
+        semaphore_type_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        semaphore_type_create_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        semaphore_type_create_info.initialValue = 0;
+
+        semaphore_create_info.pNext = &semaphore_type_create_info;
+
+        if (vkCreateSemaphore(m_device, &semaphore_create_info, nullptr, &m_graphics_timeline) != VK_SUCCESS ||
+            vkCreateSemaphore(m_device, &semaphore_create_info, nullptr, &m_compute_timeline) != VK_SUCCESS)
+            throw std::runtime_error("VULKAN_CREATE_SYNCHRONIZATION_OBJECTS_FAILURE");
     }
 
     void draw()
     {
-        vkWaitForFences(m_device, 1, &m_in_flight_fences[m_current_frame], VK_TRUE, UINT64_MAX);
+        {
+            TRACE_SCOPE("wait frame");
+            wait_for_frame_serial(m_frame_serials[m_current_frame]);
+        }
+
+        process_deferred_deletions();
+
+        // The frame's previous submission is done, so its timestamps and counters can be read without waiting.
+        resolve_frame_results(m_current_frame);
+
+        m_staging_ring.begin_frame(m_current_frame);
+        m_frame_descriptors.begin_frame(m_current_frame);
+        m_uniform_ring.begin_frame(m_current_frame);
+        m_upload_scheduler.collect(m_completed_frame_serial);
 
         uint32_t image_index;
-        VkResult result = vkAcquireNextImageKHR(m_device, m_swapchain, UINT64_MAX, m_image_available_semaphores[m_current_frame], VK_NULL_HANDLE, &image_index);
+        VkResult result;
+        {
+            TRACE_SCOPE("acquire");
+            result = acquire_next_image(image_index);
+        }
 
         if (result == VK_ERROR_OUT_OF_DATE_KHR)
         {
@@ -854,44 +1779,113 @@ private:
         else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
             throw std::runtime_error("VULKAN_ACQUIRE_IMAGE_FAILURE");
 
-        if (m_images_in_flight[image_index] != VK_NULL_HANDLE)
-            vkWaitForFences(m_device, 1, &m_images_in_flight[image_index], VK_TRUE, UINT64_MAX);
+        // Usually retired by the frame wait already, unless images are handed out in a different order than frames.
+        if (m_image_serials[image_index] > m_completed_frame_serial)
+        {
+            TRACE_SCOPE("wait image");
+            wait_for_frame_serial(m_image_serials[image_index]);
+        }
+
+        const uint64_t frame_serial = m_submitted_frame_serial + 1;
+        m_image_serials[image_index] = frame_serial;
+
+        // A benchmark steps the animation per frame rather than by the clock, so every run draws the same frames.
+        if (m_benchmark)
+            m_frame_time = static_cast<float>(frame_serial - 1) * BENCHMARK_FRAME_TIME;
+        else
+            m_frame_time = std::chrono::duration<float>(std::chrono::steady_clock::now() - m_start_time).count();
+
+        // The frame's instance buffer was last read by the submission just waited for.
+        m_instance_buffer.update(m_current_frame, m_frame_time, m_job_system);
+
+        // The scene is flat, so the view is just the zoom.
+        FrameUniforms frame_uniforms{};
+        frame_uniforms.view_projection = glm::mat4(1.0f);
+        frame_uniforms.view_projection[0][0] = m_options.zoom;
+        frame_uniforms.view_projection[1][1] = m_options.zoom;
+        frame_uniforms.time = m_frame_time;
+        m_frame_uniform_offset = m_uniform_ring.push(frame_uniforms);
+
+        // The compute pass is recorded by the job system while this thread prepares the frame's uploads.
+        JobSystem::JobHandle compute_job = m_job_system.submit([this](uint32_t)
+                                                               { record_compute(); });
 
-        m_images_in_flight[image_index] = m_in_flight_fences[m_current_frame];
+        record_command_buffer(image_index);
 
         VkSubmitInfo submit_info{};
         submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-        VkSemaphore wait_semaphores[] = {m_image_available_semaphores[m_current_frame]};
-        VkPipelineStageFlags wait_stages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submit_info.waitSemaphoreCount = 1;
-        submit_info.pWaitSemaphores = wait_semaphores;
-        submit_info.pWaitDstStageMask = wait_stages;
-        submit_info.commandBufferCount = 1;
-        submit_info.pCommandBuffers = &m_command_buffers[image_index];
+        // Offscreen images are neither acquired nor presented, so there's nothing to wait on or signal.
+        const bool presenting = m_swapchain != VK_NULL_HANDLE;
 
-        VkSemaphore signal_semaphores[] = {m_render_finished_semaphores[m_current_frame]};
-        submit_info.signalSemaphoreCount = 1;
+        m_wait_semaphores.clear();
+        m_wait_values.clear();
+        m_wait_stages.clear();
+
+        // Binary semaphores ignore their entry in the value array.
+        if (presenting)
+        {
+            m_wait_semaphores.push_back(m_image_available_semaphores[m_current_frame]);
+            m_wait_values.push_back(0);
+            m_wait_stages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        }
+
+        // Only indirect argument reads and vertex fetch need the compute results, so nothing earlier in the frame waits on them.
+        m_wait_semaphores.push_back(m_compute_timeline);
+        m_wait_values.push_back(frame_serial);
+        m_wait_stages.push_back(VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+
+        // Uploads go first in the same submission, the ring's barrier orders them before the draw.
+        const FrameCommands &frame_commands = m_frame_commands[m_current_frame];
+        VkCommandBuffer command_buffers[] = {frame_commands.upload_command_buffer, frame_commands.command_buffer};
+        const bool uploading = record_uploads(frame_commands.upload_command_buffer);
+
+        {
+            TRACE_SCOPE("compute");
+            m_job_system.wait(compute_job);
+            submit_compute(frame_serial);
+        }
+
+        submit_info.waitSemaphoreCount = static_cast<uint32_t>(m_wait_semaphores.size());
+        submit_info.pWaitSemaphores = m_wait_semaphores.data();
+        submit_info.pWaitDstStageMask = m_wait_stages.data();
+        submit_info.commandBufferCount = uploading ? 2 : 1;
+        submit_info.pCommandBuffers = uploading ? command_buffers : &frame_commands.command_buffer;
+
+        VkSemaphore signal_semaphores[] = {m_graphics_timeline, m_render_finished_semaphores[m_current_frame]};
+        uint64_t signal_values[] = {frame_serial, 0};
+        submit_info.signalSemaphoreCount = presenting ? 2 : 1;
         submit_info.pSignalSemaphores = signal_semaphores;
 
-        vkResetFences(m_device, 1, &m_in_flight_fences[m_current_frame]);
+        VkTimelineSemaphoreSubmitInfo timeline_submit_info{};
+        timeline_submit_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timeline_submit_info.waitSemaphoreValueCount = static_cast<uint32_t>(m_wait_values.size());
+        timeline_submit_info.pWaitSemaphoreValues = m_wait_values.data();
+        timeline_submit_info.signalSemaphoreValueCount = submit_info.signalSemaphoreCount;
+        timeline_submit_info.pSignalSemaphoreValues = signal_values;
+        submit_info.pNext = &timeline_submit_info;
 
-        if (vkQueueSubmit(m_graphics_queue, 1, &submit_info, m_in_flight_fences[m_current_frame]) != VK_SUCCESS)
-            throw std::runtime_error("VULKAN_QUEUE_SUBMIT_FAILURE");
+        {
+            TRACE_SCOPE("submit");
 
-        VkPresentInfoKHR present_info{};
-        present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+            if (Trace::is_enabled())
+                m_gpu_profiler.set_slot_submit_time(m_current_frame, Trace::now());
 
-        present_info.waitSemaphoreCount = 1;
-        present_info.pWaitSemaphores = signal_semaphores;
+            if (m_benchmark)
+                m_frame_benchmark_frames[m_current_frame] = m_benchmark->current_frame();
 
-        VkSwapchainKHR swap_chains[] = {m_swapchain};
-        present_info.swapchainCount = 1;
-        present_info.pSwapchains = swap_chains;
-        present_info.pImageIndices = &image_index;
-        present_info.pResults = nullptr;
+            if (vkQueueSubmit(m_graphics_queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
+                throw std::runtime_error("VULKAN_QUEUE_SUBMIT_FAILURE");
+        }
+
+        m_frame_serials[m_current_frame] = m_submitted_frame_serial = frame_serial;
+        m_frame_results_pending[m_current_frame] = true;
+        m_staging_ring.end_frame(m_current_frame);
 
-        result = vkQueuePresentKHR(m_present_queue, &present_info);
+        {
+            TRACE_SCOPE("present");
+            result = present_image(image_index);
+        }
 
         if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_framebuffer_resized)
         {
@@ -904,27 +1898,300 @@ private:
         m_current_frame = (m_current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
     }
 
+    void record_compute()
+    {
+        TRACE_FUNCTION();
+
+        // The frame wait covers this command buffer too, its graphics submission waited on the compute timeline.
+        VkCommandBuffer command_buffer = m_compute_command_buffers[m_current_frame];
+
+        VkCommandBufferBeginInfo command_buffer_begin_info{};
+        command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (vkBeginCommandBuffer(command_buffer, &command_buffer_begin_info) != VK_SUCCESS)
+            throw std::runtime_error("VULKAN_BEGIN_COMMAND_BUFFER_FAILURE");
+
+        TintPushConstants push_constants{};
+        push_constants.time = m_frame_time;
+        push_constants.vertex_count = m_mesh.vertex_count();
+
+        // Transient, the frame's pools are reset wholesale once this submission has completed.
+        VkDescriptorSet descriptor_set = m_frame_descriptors.allocate(m_compute_descriptor_set_layout, {{0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_tint_buffers[m_current_frame].buffer}});
+
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_compute_pipeline);
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_compute_pipeline_layout, 0, 1, &descriptor_set, 0, nullptr);
+        vkCmdPushConstants(command_buffer, m_compute_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants), &push_constants);
+        vkCmdDispatch(command_buffer, (push_constants.vertex_count + TINT_WORKGROUP_SIZE - 1) / TINT_WORKGROUP_SIZE, 1, 1);
+
+        if (m_options.draw_path == DrawPath::indirect)
+            m_indirect_draws.record_generate(command_buffer, m_current_frame, m_instance_buffer.buffer(m_current_frame), m_options.zoom);
+
+        if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+            throw std::runtime_error("VULKAN_END_COMMAND_BUFFER_FAILURE");
+    }
+
+    // Queues are externally synchronised, so submissions stay on the main thread.
+    void submit_compute(uint64_t frame_serial)
+    {
+        VkCommandBuffer command_buffer = m_compute_command_buffers[m_current_frame];
+
+        VkTimelineSemaphoreSubmitInfo timeline_submit_info{};
+        timeline_submit_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timeline_submit_info.signalSemaphoreValueCount = 1;
+        timeline_submit_info.pSignalSemaphoreValues = &frame_serial;
+
+        VkSubmitInfo submit_info{};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.pNext = &timeline_submit_info;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &command_buffer;
+        submit_info.signalSemaphoreCount = 1;
+        submit_info.pSignalSemaphores = &m_compute_timeline;
+
+        if (vkQueueSubmit(m_compute_queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
+            throw std::runtime_error("VULKAN_QUEUE_SUBMIT_FAILURE");
+    }
+
+    bool record_uploads(VkCommandBuffer command_buffer)
+    {
+        m_upload_scheduler.flush();
+
+        if (!m_staging_ring.has_pending_copies() && !m_upload_scheduler.has_pending_acquires())
+            return false;
+
+        VkCommandBufferBeginInfo command_buffer_begin_info{};
+        command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (vkBeginCommandBuffer(command_buffer, &command_buffer_begin_info) != VK_SUCCESS)
+            throw std::runtime_error("VULKAN_BEGIN_COMMAND_BUFFER_FAILURE");
+
+        // The acquires and the ring copies never touch the same buffer, an upload goes entirely through one or the other.
+        m_upload_scheduler.record_acquires(command_buffer, m_submitted_frame_serial + 1, m_wait_semaphores, m_wait_values, m_wait_stages);
+        m_staging_ring.record(command_buffer);
+
+        if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+            throw std::runtime_error("VULKAN_END_COMMAND_BUFFER_FAILURE");
+
+        return true;
+    }
+
+    void wait_for_frame_serial(uint64_t frame_serial)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        if (frame_serial > m_completed_frame_serial)
+        {
+            VkSemaphoreWaitInfo wait_info{};
+            wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+            wait_info.semaphoreCount = 1;
+            wait_info.pSemaphores = &m_graphics_timeline;
+            wait_info.pValues = &frame_serial;
+
+            if (vkWaitSemaphores(m_device, &wait_info, UINT64_MAX) != VK_SUCCESS)
+                throw std::runtime_error("VULKAN_WAIT_SEMAPHORES_FAILURE");
+
+            // Frames retire in submission order, so the serial just waited on covers everything before it too.
+            m_completed_frame_serial = frame_serial;
+        }
+
+        if (m_benchmark)
+        {
+            std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+            m_benchmark->add_fence_wait(duration.count());
+        }
+    }
+
+    void resolve_frame_results(uint32_t frame)
+    {
+        // A frame that returned early after acquiring has nothing new in its slot.
+        if (!m_frame_results_pending[frame])
+            return;
+
+        m_frame_results_pending[frame] = false;
+        m_gpu_profiler.resolve(frame);
+
+        if (m_benchmark && m_gpu_profiler.is_enabled())
+            m_benchmark->record_gpu_time(m_frame_benchmark_frames[frame], m_gpu_profiler.last_zone_duration(m_gpu_zone_frame));
+
+        if (m_options.draw_path == DrawPath::indirect)
+        {
+            IndirectDraws::Counters counters = m_indirect_draws.read_counters(frame);
+
+            m_drawn_instances += counters.drawn;
+            m_culled_instances += counters.culled;
+            m_culled_frames++;
+
+            if (m_benchmark)
+                m_benchmark->record_culling(m_frame_benchmark_frames[frame], counters.drawn, counters.culled);
+        }
+    }
+
+    VkResult acquire_next_image(uint32_t &image_index)
+    {
+        if (m_swapchain == VK_NULL_HANDLE)
+        {
+            image_index = m_offscreen_image_index;
+            m_offscreen_image_index = (m_offscreen_image_index + 1) % static_cast<uint32_t>(m_swapchain_images.size());
+
+            return VK_SUCCESS;
+        }
+
+        return vkAcquireNextImageKHR(m_device, m_swapchain, UINT64_MAX, m_image_available_semaphores[m_current_frame], VK_NULL_HANDLE, &image_index);
+    }
+
+    VkResult present_image(uint32_t image_index)
+    {
+        if (m_swapchain == VK_NULL_HANDLE)
+            return VK_SUCCESS;
+
+        VkPresentInfoKHR present_info{};
+        present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+
+        present_info.waitSemaphoreCount = 1;
+        present_info.pWaitSemaphores = &m_render_finished_semaphores[m_current_frame];
+
+        VkSwapchainKHR swap_chains[] = {m_swapchain};
+        present_info.swapchainCount = 1;
+        present_info.pSwapchains = swap_chains;
+        present_info.pImageIndices = &image_index;
+        present_info.pResults = nullptr;
+
+        return vkQueuePresentKHR(m_present_queue, &present_info);
+    }
+
     void recreate_swapchain()
     {
+        TRACE_FUNCTION();
+
         int width = 0, height = 0;
-        glfwGetFramebufferSize(m_window, &width, &height);
 
-        while (width == 0 || height == 0)
+        while (m_window && (width == 0 || height == 0))
         {
             glfwGetFramebufferSize(m_window, &width, &height);
-            glfwWaitEvents();
+
+            if (width == 0 || height == 0)
+                glfwWaitEvents();
         }
 
-        vkDeviceWaitIdle(m_device);
+        VkFormat previous_image_format = m_swapchain_image_format;
+        VkSwapchainKHR old_swapchain = m_swapchain;
 
-        cleanup_swapchain();
+        // Frames already submitted keep using the old handles, they're destroyed once those frames have retired.
+        retire_swapchain_resources();
+
+        create_swapchain(old_swapchain);
+
+        // The presentation engine may still be showing the old images after the last frame has retired, so keep the
+        // retired swapchain around until a frame on the new one has completed as well.
+        defer_deletion([this, old_swapchain]()
+                       { vkDestroySwapchainKHR(m_device, old_swapchain, nullptr); },
+                       m_submitted_frame_serial + 1);
 
-        create_swapchain();
         create_image_views();
-        create_render_pass();
-        create_graphics_pipeline();
+
+        // Viewport and scissor are dynamic, so the render pass and pipeline only depend on the image format.
+        if (m_swapchain_image_format != previous_image_format)
+        {
+            SPDLOG_INFO("Swapchain image format changed, rebuilding render pass and graphics pipeline");
+
+            defer_deletion([this, pipeline = m_graphics_pipeline, pipeline_layout = m_pipeline_layout, render_pass = m_render_pass]()
+                           {
+                               vkDestroyPipeline(m_device, pipeline, nullptr);
+                               vkDestroyPipelineLayout(m_device, pipeline_layout, nullptr);
+                               vkDestroyRenderPass(m_device, render_pass, nullptr); });
+
+            create_render_pass();
+            create_graphics_pipeline();
+        }
+
         create_framebuffers();
-        create_command_buffers();
+
+        m_image_serials.assign(m_swapchain_images.size(), 0);
+    }
+
+    void retire_swapchain_resources()
+    {
+        defer_deletion([this, framebuffers = std::move(m_swapchain_framebuffers), image_views = std::move(m_swapchain_image_views)]()
+                       {
+                           for (auto framebuffer : framebuffers)
+                               vkDestroyFramebuffer(m_device, framebuffer, nullptr);
+
+                           for (auto image_view : image_views)
+                               vkDestroyImageView(m_device, image_view, nullptr); });
+
+        m_swapchain_framebuffers.clear();
+        m_swapchain_image_views.clear();
+        m_swapchain_images.clear();
+    }
+
+    struct DeferredDeletion
+    {
+        uint64_t frame_serial;
+        std::function<void()> destroy;
+    };
+
+    void defer_deletion(std::function<void()> destroy)
+    {
+        defer_deletion(std::move(destroy), m_submitted_frame_serial);
+    }
+
+    void defer_deletion(std::function<void()> destroy, uint64_t frame_serial)
+    {
+        m_deferred_deletions.push_back({frame_serial, std::move(destroy)});
+    }
+
+    void process_deferred_deletions()
+    {
+        while (!m_deferred_deletions.empty() && m_deferred_deletions.front().frame_serial <= m_completed_frame_serial)
+        {
+            m_deferred_deletions.front().destroy();
+            m_deferred_deletions.pop_front();
+        }
+    }
+
+    void flush_deferred_deletions()
+    {
+        for (auto &deletion : m_deferred_deletions)
+            deletion.destroy();
+
+        m_deferred_deletions.clear();
+    }
+
+    void run_resize_storm()
+    {
+        std::vector<double> durations;
+        durations.reserve(m_options.resize_storm);
+
+        for (uint32_t i = 0; i < m_options.resize_storm && !glfwWindowShouldClose(m_window); i++)
+        {
+            // Walk through a spread of sizes so every recreation sees a different extent.
+            int width = WINDOW_WIDTH - static_cast<int>(i % 8) * (WINDOW_WIDTH / 16);
+            int height = WINDOW_HEIGHT - static_cast<int>(i % 5) * (WINDOW_HEIGHT / 10);
+
+            glfwSetWindowSize(m_window, width, height);
+            glfwPollEvents();
+
+            auto start = std::chrono::steady_clock::now();
+            recreate_swapchain();
+            std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+
+            durations.push_back(duration.count());
+            m_framebuffer_resized = false;
+
+            draw();
+        }
+
+        glfwSetWindowSize(m_window, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+        if (durations.empty())
+            return;
+
+        Statistics statistics = compute_statistics(durations);
+
+        SPDLOG_INFO("Resize storm: {} resizes, min {:.3f} ms, avg {:.3f} ms, median {:.3f} ms, p99 {:.3f} ms, max {:.3f} ms",
+                    statistics.count, statistics.min, statistics.mean, statistics.median, statistics.p99, statistics.max);
     }
 
     void cleanup_swapchain()
@@ -932,23 +2199,21 @@ private:
         for (auto framebuffer : m_swapchain_framebuffers)
             vkDestroyFramebuffer(m_device, framebuffer, nullptr);
 
-        vkFreeCommandBuffers(m_device, m_command_pool, static_cast<uint32_t>(m_command_buffers.size()), m_command_buffers.data());
-
-        vkDestroyPipeline(m_device, m_graphics_pipeline, nullptr);
-        vkDestroyPipelineLayout(m_device, m_pipeline_layout, nullptr);
-        vkDestroyRenderPass(m_device, m_render_pass, nullptr);
-
         for (auto image_view : m_swapchain_image_views)
             vkDestroyImageView(m_device, image_view, nullptr);
 
-        vkDestroySwapchainKHR(m_device, m_swapchain, nullptr);
+        if (m_swapchain != VK_NULL_HANDLE)
+            vkDestroySwapchainKHR(m_device, m_swapchain, nullptr);
+
+        for (auto &image : m_offscreen_images)
+            m_memory_allocator.destroy_image(image);
     }
 
     const std::vector<const char *> m_validation_layers{
         "VK_LAYER_KHRONOS_validation",
     };
 
-    const std::vector<const char *> m_device_extensions = {
+    std::vector<const char *> m_device_extensions = {
         VK_KHR_SWAPCHAIN_EXTENSION_NAME,
 #if __APPLE__
         "VK_KHR_portability_subset",
@@ -1003,25 +2268,82 @@ private:
         return VK_FALSE;
     }
 
-    static std::vector<char> read_file(const std::string &path)
+    // Compiled SPIR-V of a shader by its source file name, e.g. "shader.vert". The build embeds every shader, so this
+    // never touches the disk or copies anything. A reloaded shader's code stays valid until it's reloaded again.
+    ShaderCode load_shader(const std::string &name) const
+    {
+#ifdef HOT_RELOAD
+        auto it = m_reloaded_shaders.find(name);
+        if (it != m_reloaded_shaders.end())
+            return {it->second.data(), it->second.size() * sizeof(uint32_t)};
+#endif
+
+        for (const auto &shader : EMBEDDED_SHADERS)
+            if (name == shader.name)
+                return {shader.code, shader.size};
+
+        SPDLOG_ERROR("No embedded shader named {}", name);
+        throw std::runtime_error("SHADER_NOT_FOUND");
+    }
+
+#ifdef HOT_RELOAD
+    void create_shader_reloader()
+    {
+        TRACE_FUNCTION();
+
+        m_shader_reloader.create(SHADER_SOURCE_DIRECTORY);
+    }
+
+    // Runs between frames, so nothing is recording with the pipelines it replaces. Frames already submitted keep the
+    // old ones, they're destroyed once those frames have retired.
+    void reload_shaders()
     {
-        std::ifstream file(path, std::ios::ate | std::ios::binary);
+        std::vector<ShaderReloader::CompiledShader> shaders = m_shader_reloader.take_compiled();
+
+        if (shaders.empty())
+            return;
+
+        TRACE_FUNCTION();
 
-        if (!file.is_open())
+        bool graphics = false;
+        bool tint = false;
+
+        for (auto &shader : shaders)
         {
-            SPDLOG_ERROR("cloudn't open file: {}", path);
-            throw std::runtime_error("FILE_NOT_FOUND");
+            if (shader.name == "shader.vert" || shader.name == "shader.frag")
+                graphics = true;
+            else if (shader.name == "tint.comp")
+                tint = true;
+            else
+            {
+                SPDLOG_WARN("{} can't be swapped at runtime, restart to pick it up", shader.name);
+                continue;
+            }
+
+            m_reloaded_shaders[shader.name] = std::move(shader.code);
         }
 
-        size_t file_size = (size_t)file.tellg();
-        std::vector<char> buffer(file_size);
+        if (graphics)
+        {
+            defer_deletion([this, pipeline = m_graphics_pipeline, pipeline_layout = m_pipeline_layout]()
+                           {
+                               vkDestroyPipeline(m_device, pipeline, nullptr);
+                               vkDestroyPipelineLayout(m_device, pipeline_layout, nullptr); });
+
+            create_graphics_pipeline();
+            SPDLOG_INFO("Graphics pipeline reloaded");
+        }
 
-        file.seekg(0);
-        file.read(buffer.data(), file_size);
-        file.close();
+        if (tint)
+        {
+            defer_deletion([this, pipeline = m_compute_pipeline]()
+                           { vkDestroyPipeline(m_device, pipeline, nullptr); });
 
-        return buffer;
+            create_tint_pipeline();
+            SPDLOG_INFO("Tint pipeline reloaded");
+        }
     }
+#endif
 
     static void framebuffer_resized_callback(GLFWwindow *window, int width, int height)
     {
@@ -1029,45 +2351,124 @@ private:
         app->m_framebuffer_resized = true;
     }
 
+    const Options m_options;
     GLFWwindow *m_window = nullptr;
     VkDebugUtilsMessengerEXT m_debug_messenger;
     VkInstance m_instance;
     VkPhysicalDevice m_physical_device = VK_NULL_HANDLE;
     VkDevice m_device;
     VkQueue m_graphics_queue;
-    VkSurfaceKHR m_surface;
+    VkSurfaceKHR m_surface = VK_NULL_HANDLE;
     VkQueue m_present_queue;
-    VkSwapchainKHR m_swapchain;
+    VkSwapchainKHR m_swapchain = VK_NULL_HANDLE;
     std::vector<VkImage> m_swapchain_images;
     VkFormat m_swapchain_image_format;
+    VkPresentModeKHR m_present_mode;
     VkExtent2D m_swapchain_extent;
     std::vector<VkImageView> m_swapchain_image_views;
+    std::vector<Image> m_offscreen_images;
+    uint32_t m_offscreen_image_index = 0;
     VkRenderPass m_render_pass;
     VkPipelineLayout m_pipeline_layout;
     VkPipeline m_graphics_pipeline;
+    PipelineCache m_pipeline_cache;
+    MemoryAllocator m_memory_allocator;
+    Mesh m_mesh;
+    StagingRing m_staging_ring;
+    FrameDescriptorAllocator m_frame_descriptors;
+    DescriptorSetCache m_descriptor_cache;
+    UniformRing m_uniform_ring;
+    uint32_t m_frame_uniform_offset = 0;
+#ifdef HOT_RELOAD
+    ShaderReloader m_shader_reloader;
+    std::unordered_map<std::string, std::vector<uint32_t>> m_reloaded_shaders;
+#endif
+    VkQueue m_compute_queue;
+    VkCommandPool m_compute_command_pool;
+    std::vector<VkCommandBuffer> m_compute_command_buffers;
+    VkSemaphore m_compute_timeline;
+    VkDescriptorSetLayout m_compute_descriptor_set_layout;
+    VkPipelineLayout m_compute_pipeline_layout;
+    VkPipeline m_compute_pipeline;
+    std::vector<Buffer> m_tint_buffers;
+    IndirectDraws m_indirect_draws;
+    InstanceBuffer m_instance_buffer;
+    BindlessHeap m_bindless_heap;
+    MaterialLibrary m_materials;
+    IndirectDraws::Features m_indirect_features{};
+    uint64_t m_drawn_instances = 0;
+    uint64_t m_culled_instances = 0;
+    uint64_t m_culled_frames = 0;
+
+    struct ThreadCommands
+    {
+        VkCommandPool command_pool;
+        std::vector<VkCommandBuffer> command_buffers;
+        uint32_t used = 0;
+    };
+
+    // Everything a frame in flight records, the pools are reset once the frame has retired.
+    struct FrameCommands
+    {
+        VkCommandPool command_pool;
+        VkCommandBuffer command_buffer;
+        VkCommandBuffer upload_command_buffer;
+        std::vector<ThreadCommands> threads;
+    };
+
+    JobSystem m_job_system;
+    std::vector<FrameCommands> m_frame_commands;
+    std::vector<VkCommandBuffer> m_secondary_command_buffers;
+    std::vector<DrawRange> m_draw_ranges;
+    std::vector<DrawBounds> m_draw_bounds;
+    DrawBounds m_mesh_bounds{};
+    std::chrono::steady_clock::time_point m_start_time = std::chrono::steady_clock::now();
+    static constexpr float BENCHMARK_FRAME_TIME = 1.0f / 60.0f;
+    // Animation time of the frame being recorded, in seconds.
+    float m_frame_time = 0.0f;
+    UploadScheduler m_upload_scheduler;
+    VkQueue m_transfer_queue;
+    std::vector<VkSemaphore> m_wait_semaphores;
+    std::vector<uint64_t> m_wait_values;
+    std::vector<VkPipelineStageFlags> m_wait_stages;
     std::vector<VkFramebuffer> m_swapchain_framebuffers;
-    VkCommandPool m_command_pool;
-    std::vector<VkCommandBuffer> m_command_buffers;
+    GpuProfiler m_gpu_profiler;
+    uint32_t m_gpu_zone_frame;
+    uint32_t m_gpu_zone_render_pass;
+    uint32_t m_gpu_zone_draw;
     std::vector<VkSemaphore> m_image_available_semaphores;
     std::vector<VkSemaphore> m_render_finished_semaphores;
-    std::vector<VkFence> m_in_flight_fences;
-    std::vector<VkFence> m_images_in_flight;
+    VkSemaphore m_graphics_timeline;
+    std::vector<uint64_t> m_image_serials;
+    std::optional<Benchmark> m_benchmark;
+    int64_t m_frame_benchmark_frames[MAX_FRAMES_IN_FLIGHT] = {};
+    bool m_frame_results_pending[MAX_FRAMES_IN_FLIGHT] = {};
     size_t m_current_frame = 0;
+    uint64_t m_frame_serials[MAX_FRAMES_IN_FLIGHT] = {};
+    uint64_t m_submitted_frame_serial = 0;
+    uint64_t m_completed_frame_serial = 0;
+    std::deque<DeferredDeletion> m_deferred_deletions;
     bool m_framebuffer_resized = false;
 };
 
-int main()
+int main(int argc, char **argv)
 {
     spdlog::set_level(spdlog::level::trace);
     spdlog::set_pattern("%^[%T] %v%$");
 
     SPDLOG_INFO("HelloVulkan v{}.{}.{}", PROJECT_VERSION_MAJOR, PROJECT_VERSION_MINOR, PROJECT_VERSION_PATCH);
 
-    HelloTriangleApplication app;
-
     try
     {
+        Options options = parse_options(argc, argv);
+
+        if (!options.trace_path.empty())
+            Trace::enable(TRACE_CAPACITY);
+
+        HelloTriangleApplication app(options);
         app.run();
+
+        Trace::write(options.trace_path);
     }
     catch (const std::exception &e)
     {
@@ -0,0 +1,135 @@
+#include "materials.h"
+
+#include <functional>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "trace.h"
+
+static std::vector<uint32_t> make_texels(uint32_t size, const std::function<bool(uint32_t, uint32_t)> &pattern)
+{
+    std::vector<uint32_t> texels(size * size);
+
+    // RGBA8, a light texel where the pattern is set and a darker one elsewhere.
+    for (uint32_t y = 0; y < size; y++)
+        for (uint32_t x = 0; x < size; x++)
+            texels[y * size + x] = pattern(x, y) ? 0xffffffffu : 0xff999999u;
+
+    return texels;
+}
+
+void MaterialLibrary::create(MemoryAllocator &allocator, VkDevice device, StagingRing &staging_ring, BindlessHeap &bindless_heap)
+{
+    TRACE_FUNCTION();
+
+    m_allocator = &allocator;
+    m_device = device;
+    m_bindless_heap = &bindless_heap;
+
+    VkSamplerCreateInfo sampler_create_info{};
+    sampler_create_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    sampler_create_info.magFilter = VK_FILTER_LINEAR;
+    sampler_create_info.minFilter = VK_FILTER_LINEAR;
+    sampler_create_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    sampler_create_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    sampler_create_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    sampler_create_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    sampler_create_info.maxLod = 0.0f;
+
+    if (vkCreateSampler(m_device, &sampler_create_info, nullptr, &m_sampler) != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_CREATE_SAMPLER_FAILURE");
+
+    const uint32_t size = TEXTURE_SIZE;
+    m_textures.push_back(create_texture(staging_ring, make_texels(size, [](uint32_t, uint32_t)
+                                                                  { return true; })));
+    m_textures.push_back(create_texture(staging_ring, make_texels(size, [](uint32_t x, uint32_t y)
+                                                                  { return ((x / 8) + (y / 8)) % 2 == 0; })));
+    m_textures.push_back(create_texture(staging_ring, make_texels(size, [](uint32_t x, uint32_t)
+                                                                  { return (x / 4) % 2 == 0; })));
+    m_textures.push_back(create_texture(staging_ring, make_texels(size, [](uint32_t x, uint32_t y)
+                                                                  {
+                                                                      const int dx = static_cast<int>(x % 16) - 8;
+                                                                      const int dy = static_cast<int>(y % 16) - 8;
+                                                                      return dx * dx + dy * dy > 16; })));
+
+    const std::vector<Material> materials = {
+        {{1.0f, 1.0f, 1.0f, 1.0f}, m_textures[0].slot, {}},
+        {{1.0f, 0.7f, 0.7f, 1.0f}, m_textures[1].slot, {}},
+        {{0.7f, 1.0f, 0.7f, 1.0f}, m_textures[2].slot, {}},
+        {{0.7f, 0.7f, 1.0f, 1.0f}, m_textures[3].slot, {}},
+    };
+
+    const VkDeviceSize buffer_size = materials.size() * sizeof(Material);
+    m_buffer = m_allocator->create_buffer(buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (!staging_ring.copy_to_buffer(m_buffer.buffer, 0, materials.data(), buffer_size))
+        throw std::runtime_error("MATERIAL_UPLOAD_FAILURE");
+
+    m_buffer_slot = m_bindless_heap->register_buffer(m_buffer.buffer);
+
+    SPDLOG_INFO("Materials: {} in buffer slot {}, {} textures of {}x{}", materials.size(), m_buffer_slot, m_textures.size(), size, size);
+}
+
+void MaterialLibrary::destroy()
+{
+    if (m_allocator == nullptr)
+        return;
+
+    m_bindless_heap->release_buffer(m_buffer_slot);
+    m_allocator->destroy_buffer(m_buffer);
+
+    for (auto &texture : m_textures)
+    {
+        m_bindless_heap->release_image(texture.slot);
+        vkDestroyImageView(m_device, texture.image_view, nullptr);
+        m_allocator->destroy_image(texture.image);
+    }
+
+    vkDestroySampler(m_device, m_sampler, nullptr);
+
+    m_textures.clear();
+    m_allocator = nullptr;
+}
+
+MaterialLibrary::Texture MaterialLibrary::create_texture(StagingRing &staging_ring, const std::vector<uint32_t> &texels)
+{
+    Texture texture;
+
+    VkImageCreateInfo create_info{};
+    create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    create_info.imageType = VK_IMAGE_TYPE_2D;
+    create_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+    create_info.extent = {TEXTURE_SIZE, TEXTURE_SIZE, 1};
+    create_info.mipLevels = 1;
+    create_info.arrayLayers = 1;
+    create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    create_info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    texture.image = m_allocator->create_image(create_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    // The ring leaves the image in SHADER_READ_ONLY_OPTIMAL, ahead of the first draw that samples it.
+    VkBufferImageCopy region{};
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent = {TEXTURE_SIZE, TEXTURE_SIZE, 1};
+
+    if (!staging_ring.copy_to_image(texture.image.image, region, texels.data(), texels.size() * sizeof(uint32_t), sizeof(uint32_t)))
+        throw std::runtime_error("TEXTURE_UPLOAD_FAILURE");
+
+    VkImageViewCreateInfo view_create_info{};
+    view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    view_create_info.image = texture.image.image;
+    view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_create_info.format = create_info.format;
+    view_create_info.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+    if (vkCreateImageView(m_device, &view_create_info, nullptr, &texture.image_view) != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_CREATE_IMAGE_VIEW_FAILURE");
+
+    texture.slot = m_bindless_heap->register_image(texture.image_view, m_sampler);
+
+    return texture;
+}
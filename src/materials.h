@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+
+#include "bindless.h"
+#include "memory_allocator.h"
+#include "staging_ring.h"
+
+// Matches the Material struct of shader.frag, padded to its std430 array stride.
+struct Material
+{
+    glm::vec4 color;
+    uint32_t texture;
+    uint32_t padding[3];
+};
+
+// The materials instances pick by id, a storage buffer of Material entries and the textures they sample, all reached
+// through the bindless heap. Shaders find the buffer through buffer_slot() and a material's texture through its slot in
+// the entry, so nothing here is bound per draw. Material 0 is plain white and leaves colours untouched.
+class MaterialLibrary
+{
+public:
+    void create(MemoryAllocator &allocator, VkDevice device, StagingRing &staging_ring, BindlessHeap &bindless_heap);
+    void destroy();
+
+    uint32_t buffer_slot() const { return m_buffer_slot; }
+    uint32_t material_count() const { return static_cast<uint32_t>(m_textures.size()); }
+
+private:
+    struct Texture
+    {
+        Image image;
+        VkImageView image_view = VK_NULL_HANDLE;
+        uint32_t slot = 0;
+    };
+
+    static constexpr uint32_t TEXTURE_SIZE = 64;
+
+    Texture create_texture(StagingRing &staging_ring, const std::vector<uint32_t> &texels);
+
+    MemoryAllocator *m_allocator = nullptr;
+    VkDevice m_device = VK_NULL_HANDLE;
+    BindlessHeap *m_bindless_heap = nullptr;
+    VkSampler m_sampler = VK_NULL_HANDLE;
+    std::vector<Texture> m_textures;
+    Buffer m_buffer;
+    uint32_t m_buffer_slot = 0;
+};
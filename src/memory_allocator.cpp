@@ -0,0 +1,486 @@
+#include "memory_allocator.h"
+
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "HelloVulkan_config.h"
+
+// Smallest range handed out, also keeps sub-allocations at least as aligned as any nonCoherentAtomSize in practice.
+static constexpr VkDeviceSize MIN_ALLOCATION_SIZE = 256;
+
+struct MemoryBlock
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    void *mapped = nullptr;
+    VkDeviceSize size = 0;
+    uint32_t memory_type_index = 0;
+    bool dedicated = false;
+
+    // Free ranges by order, order n ranges are MIN_ALLOCATION_SIZE << n bytes.
+    std::vector<std::set<VkDeviceSize>> free_lists;
+    uint32_t allocation_count = 0;
+    VkDeviceSize allocated_bytes = 0;
+    VkDeviceSize reserved_bytes = 0;
+};
+
+static uint32_t order_for_size(VkDeviceSize size)
+{
+    uint32_t order = 0;
+
+    while ((MIN_ALLOCATION_SIZE << order) < size)
+        order++;
+
+    return order;
+}
+
+MemoryAllocator::MemoryAllocator() = default;
+MemoryAllocator::~MemoryAllocator() = default;
+
+void MemoryAllocator::create(VkPhysicalDevice physical_device, VkDevice device)
+{
+    m_device = device;
+
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &m_memory_properties);
+
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(physical_device, &device_properties);
+
+    m_buffer_image_granularity = device_properties.limits.bufferImageGranularity;
+    m_non_coherent_atom_size = device_properties.limits.nonCoherentAtomSize;
+    m_max_allocation_count = device_properties.limits.maxMemoryAllocationCount;
+
+    // Small heaps, like the 256 MiB host visible device local window, get proportionally smaller blocks.
+    m_block_sizes.resize(m_memory_properties.memoryHeapCount);
+    for (uint32_t i = 0; i < m_memory_properties.memoryHeapCount; i++)
+    {
+        VkDeviceSize block_size = MEMORY_BLOCK_SIZE;
+
+        while (block_size > MIN_ALLOCATION_SIZE && block_size > m_memory_properties.memoryHeaps[i].size / 8)
+            block_size /= 2;
+
+        m_block_sizes[i] = block_size;
+    }
+
+    SPDLOG_TRACE("Memory allocator: bufferImageGranularity {}, maxMemoryAllocationCount {}", m_buffer_image_granularity, m_max_allocation_count);
+}
+
+void MemoryAllocator::destroy()
+{
+    for (auto &pool : m_pools)
+        for (auto &block : pool.blocks)
+        {
+            if (block->allocation_count > 0)
+                SPDLOG_WARN("Memory block destroyed with {} live allocations", block->allocation_count);
+
+            vkFreeMemory(m_device, block->memory, nullptr);
+        }
+
+    if (!m_dedicated_blocks.empty())
+        SPDLOG_WARN("{} dedicated allocations leaked", m_dedicated_blocks.size());
+
+    for (auto &block : m_dedicated_blocks)
+        vkFreeMemory(m_device, block->memory, nullptr);
+
+    m_pools.clear();
+    m_dedicated_blocks.clear();
+    m_device_allocations = 0;
+}
+
+Allocation MemoryAllocator::allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags required_properties, VkMemoryPropertyFlags preferred_properties, ResourceKind kind,
+                                     const VkMemoryDedicatedAllocateInfo *dedicated_info, bool dedicated)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint32_t memory_type_index = find_memory_type(requirements.memoryTypeBits, required_properties, preferred_properties);
+    VkDeviceSize block_size = m_block_sizes[m_memory_properties.memoryTypes[memory_type_index].heapIndex];
+
+    Allocation allocation;
+    allocation.size = requirements.size;
+
+    if (dedicated || requirements.size > block_size / 2 || requirements.alignment > block_size)
+    {
+        auto block = std::make_unique<MemoryBlock>();
+        block->memory_type_index = memory_type_index;
+        block->size = requirements.size;
+        block->dedicated = true;
+        block->memory = allocate_device_memory(memory_type_index, requirements.size, &block->mapped, dedicated_info);
+        block->allocation_count = 1;
+        block->allocated_bytes = requirements.size;
+
+        allocation.memory = block->memory;
+        allocation.mapped = block->mapped;
+        allocation.block = block.get();
+
+        m_dedicated_blocks.push_back(std::move(block));
+
+        return allocation;
+    }
+
+    // Buddy ranges sit at multiples of their own size, so rounding up to the alignment is all alignment needs.
+    uint32_t order = order_for_size(std::max(requirements.size, requirements.alignment));
+
+    Pool &pool = find_pool(memory_type_index, kind);
+
+    MemoryBlock *block = nullptr;
+    uint32_t available_order = 0;
+
+    for (auto &candidate : pool.blocks)
+    {
+        for (available_order = order; available_order < candidate->free_lists.size(); available_order++)
+            if (!candidate->free_lists[available_order].empty())
+                break;
+
+        if (available_order < candidate->free_lists.size())
+        {
+            block = candidate.get();
+            break;
+        }
+    }
+
+    if (block == nullptr)
+    {
+        block = create_block(pool);
+        available_order = static_cast<uint32_t>(block->free_lists.size() - 1);
+    }
+
+    VkDeviceSize offset = *block->free_lists[available_order].begin();
+    block->free_lists[available_order].erase(block->free_lists[available_order].begin());
+
+    // Split down to the requested order, every split leaves the upper half free.
+    while (available_order > order)
+    {
+        available_order--;
+        block->free_lists[available_order].insert(offset + (MIN_ALLOCATION_SIZE << available_order));
+    }
+
+    block->allocation_count++;
+    block->allocated_bytes += requirements.size;
+    block->reserved_bytes += MIN_ALLOCATION_SIZE << order;
+
+    allocation.memory = block->memory;
+    allocation.offset = offset;
+    allocation.mapped = block->mapped ? static_cast<char *>(block->mapped) + offset : nullptr;
+    allocation.block = block;
+    allocation.order = order;
+
+    return allocation;
+}
+
+void MemoryAllocator::free(Allocation &allocation)
+{
+    if (allocation.block == nullptr)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    MemoryBlock *block = allocation.block;
+
+    if (block->dedicated)
+    {
+        vkFreeMemory(m_device, block->memory, nullptr);
+        m_device_allocations--;
+
+        m_dedicated_blocks.erase(std::find_if(m_dedicated_blocks.begin(), m_dedicated_blocks.end(), [block](const std::unique_ptr<MemoryBlock> &dedicated_block)
+                                              { return dedicated_block.get() == block; }));
+    }
+    else
+    {
+        VkDeviceSize offset = allocation.offset;
+        uint32_t order = allocation.order;
+
+        block->allocation_count--;
+        block->allocated_bytes -= allocation.size;
+        block->reserved_bytes -= MIN_ALLOCATION_SIZE << order;
+
+        // Merge with the buddy for as long as it's free as well.
+        while (order + 1 < block->free_lists.size())
+        {
+            VkDeviceSize buddy = offset ^ (MIN_ALLOCATION_SIZE << order);
+            auto buddy_it = block->free_lists[order].find(buddy);
+
+            if (buddy_it == block->free_lists[order].end())
+                break;
+
+            block->free_lists[order].erase(buddy_it);
+            offset = std::min(offset, buddy);
+            order++;
+        }
+
+        block->free_lists[order].insert(offset);
+
+        if (block->allocation_count == 0)
+            release_block(block);
+    }
+
+    allocation = Allocation{};
+}
+
+Buffer MemoryAllocator::create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags required_properties, VkMemoryPropertyFlags preferred_properties,
+                                      const std::vector<uint32_t> &queue_family_indices)
+{
+    VkBufferCreateInfo create_info{};
+    create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    create_info.size = size;
+    create_info.usage = usage;
+
+    if (queue_family_indices.size() > 1)
+    {
+        create_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        create_info.queueFamilyIndexCount = static_cast<uint32_t>(queue_family_indices.size());
+        create_info.pQueueFamilyIndices = queue_family_indices.data();
+    }
+    else
+        create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    Buffer buffer;
+    if (vkCreateBuffer(m_device, &create_info, nullptr, &buffer.buffer) != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_CREATE_BUFFER_FAILURE");
+
+    VkBufferMemoryRequirementsInfo2 requirements_info{};
+    requirements_info.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+    requirements_info.buffer = buffer.buffer;
+
+    VkMemoryDedicatedRequirements dedicated_requirements{};
+    dedicated_requirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+    VkMemoryRequirements2 memory_requirements{};
+    memory_requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    memory_requirements.pNext = &dedicated_requirements;
+
+    vkGetBufferMemoryRequirements2(m_device, &requirements_info, &memory_requirements);
+
+    VkMemoryDedicatedAllocateInfo dedicated_info{};
+    dedicated_info.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+    dedicated_info.buffer = buffer.buffer;
+
+    const bool dedicated = dedicated_requirements.prefersDedicatedAllocation || dedicated_requirements.requiresDedicatedAllocation;
+    buffer.allocation = allocate(memory_requirements.memoryRequirements, required_properties, preferred_properties, ResourceKind::linear, &dedicated_info, dedicated);
+
+    if (vkBindBufferMemory(m_device, buffer.buffer, buffer.allocation.memory, buffer.allocation.offset) != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_BIND_BUFFER_MEMORY_FAILURE");
+
+    return buffer;
+}
+
+void MemoryAllocator::destroy_buffer(Buffer &buffer)
+{
+    if (buffer.buffer != VK_NULL_HANDLE)
+        vkDestroyBuffer(m_device, buffer.buffer, nullptr);
+
+    free(buffer.allocation);
+    buffer.buffer = VK_NULL_HANDLE;
+}
+
+Image MemoryAllocator::create_image(const VkImageCreateInfo &create_info, VkMemoryPropertyFlags required_properties, VkMemoryPropertyFlags preferred_properties)
+{
+    Image image;
+    if (vkCreateImage(m_device, &create_info, nullptr, &image.image) != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_CREATE_IMAGE_FAILURE");
+
+    VkImageMemoryRequirementsInfo2 requirements_info{};
+    requirements_info.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+    requirements_info.image = image.image;
+
+    VkMemoryDedicatedRequirements dedicated_requirements{};
+    dedicated_requirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+    VkMemoryRequirements2 memory_requirements{};
+    memory_requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    memory_requirements.pNext = &dedicated_requirements;
+
+    vkGetImageMemoryRequirements2(m_device, &requirements_info, &memory_requirements);
+
+    // Render targets are the usual case of a driver preferring, or requiring, memory of their own.
+    VkMemoryDedicatedAllocateInfo dedicated_info{};
+    dedicated_info.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+    dedicated_info.image = image.image;
+
+    const bool dedicated = dedicated_requirements.prefersDedicatedAllocation || dedicated_requirements.requiresDedicatedAllocation;
+    ResourceKind kind = create_info.tiling == VK_IMAGE_TILING_OPTIMAL ? ResourceKind::optimal : ResourceKind::linear;
+    image.allocation = allocate(memory_requirements.memoryRequirements, required_properties, preferred_properties, kind, &dedicated_info, dedicated);
+
+    if (vkBindImageMemory(m_device, image.image, image.allocation.memory, image.allocation.offset) != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_BIND_IMAGE_MEMORY_FAILURE");
+
+    return image;
+}
+
+void MemoryAllocator::destroy_image(Image &image)
+{
+    if (image.image != VK_NULL_HANDLE)
+        vkDestroyImage(m_device, image.image, nullptr);
+
+    free(image.allocation);
+    image.image = VK_NULL_HANDLE;
+}
+
+void MemoryAllocator::flush(const Allocation &allocation, VkDeviceSize offset, VkDeviceSize size)
+{
+    if (is_coherent(allocation))
+        return;
+
+    VkDeviceSize begin = allocation.offset + offset;
+    VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.offset + allocation.size : begin + size;
+
+    // Ranges have to be aligned to nonCoherentAtomSize, the block size always is.
+    begin = begin / m_non_coherent_atom_size * m_non_coherent_atom_size;
+    end = std::min((end + m_non_coherent_atom_size - 1) / m_non_coherent_atom_size * m_non_coherent_atom_size, allocation.block->size);
+
+    VkMappedMemoryRange range{};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = allocation.memory;
+    range.offset = begin;
+    range.size = end == allocation.block->size ? VK_WHOLE_SIZE : end - begin;
+
+    vkFlushMappedMemoryRanges(m_device, 1, &range);
+}
+
+bool MemoryAllocator::is_coherent(const Allocation &allocation) const
+{
+    return m_memory_properties.memoryTypes[allocation.block->memory_type_index].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+}
+
+MemoryStatistics MemoryAllocator::statistics()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    MemoryStatistics statistics;
+    statistics.device_allocations = m_device_allocations;
+    statistics.dedicated_allocations = static_cast<uint32_t>(m_dedicated_blocks.size());
+
+    for (const auto &block : m_dedicated_blocks)
+    {
+        statistics.bytes_allocated += block->size;
+        statistics.dedicated_bytes += block->allocated_bytes;
+    }
+
+    for (const auto &pool : m_pools)
+        for (const auto &block : pool.blocks)
+        {
+            statistics.sub_allocations += block->allocation_count;
+            statistics.bytes_allocated += block->size;
+            statistics.sub_allocated_bytes += block->allocated_bytes;
+            statistics.reserved_bytes += block->reserved_bytes;
+
+            for (uint32_t order = 0; order < block->free_lists.size(); order++)
+                if (!block->free_lists[order].empty())
+                {
+                    VkDeviceSize range_size = MIN_ALLOCATION_SIZE << order;
+
+                    statistics.free_bytes += range_size * block->free_lists[order].size();
+                    statistics.largest_free_range = std::max(statistics.largest_free_range, range_size);
+                }
+        }
+
+    return statistics;
+}
+
+void MemoryAllocator::log_statistics()
+{
+    MemoryStatistics memory_statistics = statistics();
+
+    SPDLOG_INFO("Device memory: {} allocations ({} dedicated), {} sub-allocations, {:.2f} MiB allocated, {:.2f} MiB in use",
+                memory_statistics.device_allocations, memory_statistics.dedicated_allocations, memory_statistics.sub_allocations,
+                memory_statistics.bytes_allocated / 1048576.0, memory_statistics.bytes_in_use() / 1048576.0);
+    SPDLOG_INFO("\tfragmentation: {:.1f}% internal, {:.1f}% external",
+                memory_statistics.internal_fragmentation() * 100.0, memory_statistics.external_fragmentation() * 100.0);
+}
+
+uint32_t MemoryAllocator::find_memory_type(uint32_t type_filter, VkMemoryPropertyFlags required_properties, VkMemoryPropertyFlags preferred_properties) const
+{
+    VkMemoryPropertyFlags wanted_properties = required_properties | preferred_properties;
+
+    for (uint32_t i = 0; i < m_memory_properties.memoryTypeCount; i++)
+        if ((type_filter & (1 << i)) && (m_memory_properties.memoryTypes[i].propertyFlags & wanted_properties) == wanted_properties)
+            return i;
+
+    for (uint32_t i = 0; i < m_memory_properties.memoryTypeCount; i++)
+        if ((type_filter & (1 << i)) && (m_memory_properties.memoryTypes[i].propertyFlags & required_properties) == required_properties)
+            return i;
+
+    throw std::runtime_error("VULKAN_MEMORY_TYPE_NOT_FOUND");
+}
+
+VkDeviceMemory MemoryAllocator::allocate_device_memory(uint32_t memory_type_index, VkDeviceSize size, void **mapped, const void *next)
+{
+    if (m_device_allocations >= m_max_allocation_count)
+        throw std::runtime_error("VULKAN_TOO_MANY_MEMORY_ALLOCATIONS");
+
+    VkMemoryAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocate_info.pNext = next;
+    allocate_info.allocationSize = size;
+    allocate_info.memoryTypeIndex = memory_type_index;
+
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(m_device, &allocate_info, nullptr, &memory) != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_ALLOCATE_MEMORY_FAILURE");
+
+    m_device_allocations++;
+
+    if (m_device_allocations == m_max_allocation_count * 3 / 4)
+        SPDLOG_WARN("{} of {} device memory allocations in use", m_device_allocations, m_max_allocation_count);
+
+    // Host visible memory stays mapped for its whole lifetime, mapping is too slow to do per access.
+    *mapped = nullptr;
+    if (m_memory_properties.memoryTypes[memory_type_index].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        if (vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, mapped) != VK_SUCCESS)
+            throw std::runtime_error("VULKAN_MAP_MEMORY_FAILURE");
+
+    return memory;
+}
+
+MemoryAllocator::Pool &MemoryAllocator::find_pool(uint32_t memory_type_index, ResourceKind kind)
+{
+    if (m_buffer_image_granularity <= 1)
+        kind = ResourceKind::linear;
+
+    for (auto &pool : m_pools)
+        if (pool.memory_type_index == memory_type_index && pool.kind == kind)
+            return pool;
+
+    m_pools.push_back({memory_type_index, kind, {}});
+
+    return m_pools.back();
+}
+
+MemoryBlock *MemoryAllocator::create_block(Pool &pool)
+{
+    auto block = std::make_unique<MemoryBlock>();
+    block->memory_type_index = pool.memory_type_index;
+    block->size = m_block_sizes[m_memory_properties.memoryTypes[pool.memory_type_index].heapIndex];
+    block->memory = allocate_device_memory(pool.memory_type_index, block->size, &block->mapped);
+    block->free_lists.resize(order_for_size(block->size) + 1);
+    block->free_lists.back().insert(0);
+
+    SPDLOG_TRACE("Memory block allocated: {:.2f} MiB of memory type {}", block->size / 1048576.0, pool.memory_type_index);
+
+    pool.blocks.push_back(std::move(block));
+
+    return pool.blocks.back().get();
+}
+
+void MemoryAllocator::release_block(MemoryBlock *block)
+{
+    for (auto &pool : m_pools)
+    {
+        auto block_it = std::find_if(pool.blocks.begin(), pool.blocks.end(), [block](const std::unique_ptr<MemoryBlock> &pool_block)
+                                     { return pool_block.get() == block; });
+
+        if (block_it == pool.blocks.end())
+            continue;
+
+        // Keep one empty block per pool around so allocation churn doesn't turn into vkAllocateMemory churn.
+        if (pool.blocks.size() == 1)
+            return;
+
+        vkFreeMemory(m_device, block->memory, nullptr);
+        m_device_allocations--;
+        pool.blocks.erase(block_it);
+
+        return;
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+struct MemoryBlock;
+
+struct Allocation
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void *mapped = nullptr;
+
+    MemoryBlock *block = nullptr;
+    uint32_t order = 0;
+};
+
+struct Buffer
+{
+    VkBuffer buffer = VK_NULL_HANDLE;
+    Allocation allocation;
+};
+
+struct Image
+{
+    VkImage image = VK_NULL_HANDLE;
+    Allocation allocation;
+};
+
+// Buffers and linear images can't share a page with optimal images when bufferImageGranularity is larger than one,
+// so the two kinds are sub-allocated from separate blocks.
+enum class ResourceKind
+{
+    linear,
+    optimal,
+};
+
+struct MemoryStatistics
+{
+    uint32_t device_allocations = 0;
+    uint32_t dedicated_allocations = 0;
+    uint32_t sub_allocations = 0;
+    VkDeviceSize bytes_allocated = 0;
+    VkDeviceSize dedicated_bytes = 0;
+    VkDeviceSize sub_allocated_bytes = 0;
+    VkDeviceSize reserved_bytes = 0;
+    VkDeviceSize free_bytes = 0;
+    VkDeviceSize largest_free_range = 0;
+
+    VkDeviceSize bytes_in_use() const { return dedicated_bytes + sub_allocated_bytes; }
+
+    // Share of reserved ranges lost to rounding sub-allocations up to a power of two.
+    double internal_fragmentation() const { return reserved_bytes ? 1.0 - (double)sub_allocated_bytes / reserved_bytes : 0.0; }
+
+    // Share of free block memory that a single request couldn't use.
+    double external_fragmentation() const { return free_bytes ? 1.0 - (double)largest_free_range / free_bytes : 0.0; }
+};
+
+// Sub-allocates device memory out of large blocks, one set of blocks per memory type and resource kind. Each block is
+// managed as a buddy system: allocations are rounded up to a power of two, which also satisfies their alignment, and
+// freed ranges merge with their buddy. Requests bigger than half a block, and resources the driver requires or prefers
+// to have their own memory, get a dedicated vkAllocateMemory.
+class MemoryAllocator
+{
+public:
+    MemoryAllocator();
+    ~MemoryAllocator();
+
+    void create(VkPhysicalDevice physical_device, VkDevice device);
+    void destroy();
+
+    // dedicated_info names the one resource the memory is for and is chained onto the allocation whenever it ends up
+    // dedicated, which dedicated forces.
+    Allocation allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags required_properties, VkMemoryPropertyFlags preferred_properties, ResourceKind kind,
+                        const VkMemoryDedicatedAllocateInfo *dedicated_info = nullptr, bool dedicated = false);
+    void free(Allocation &allocation);
+
+    // Buffers shared by more than one queue family are created with concurrent sharing.
+    Buffer create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags required_properties, VkMemoryPropertyFlags preferred_properties = 0,
+                         const std::vector<uint32_t> &queue_family_indices = {});
+    void destroy_buffer(Buffer &buffer);
+
+    Image create_image(const VkImageCreateInfo &create_info, VkMemoryPropertyFlags required_properties, VkMemoryPropertyFlags preferred_properties = 0);
+    void destroy_image(Image &image);
+
+    void flush(const Allocation &allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+    bool is_coherent(const Allocation &allocation) const;
+
+    MemoryStatistics statistics();
+    void log_statistics();
+
+private:
+    struct Pool
+    {
+        uint32_t memory_type_index;
+        ResourceKind kind;
+        std::vector<std::unique_ptr<MemoryBlock>> blocks;
+    };
+
+    uint32_t find_memory_type(uint32_t type_filter, VkMemoryPropertyFlags required_properties, VkMemoryPropertyFlags preferred_properties) const;
+    VkDeviceMemory allocate_device_memory(uint32_t memory_type_index, VkDeviceSize size, void **mapped, const void *next = nullptr);
+
+    Pool &find_pool(uint32_t memory_type_index, ResourceKind kind);
+    MemoryBlock *create_block(Pool &pool);
+    void release_block(MemoryBlock *block);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties m_memory_properties{};
+    VkDeviceSize m_buffer_image_granularity = 1;
+    VkDeviceSize m_non_coherent_atom_size = 1;
+    uint32_t m_max_allocation_count = 0;
+    std::vector<VkDeviceSize> m_block_sizes;
+
+    std::mutex m_mutex;
+    std::vector<Pool> m_pools;
+    std::vector<std::unique_ptr<MemoryBlock>> m_dedicated_blocks;
+    uint32_t m_device_allocations = 0;
+};
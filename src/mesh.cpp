@@ -0,0 +1,237 @@
+#include "mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "HelloVulkan_config.h"
+#include "trace.h"
+
+MeshData make_triangle_mesh()
+{
+    MeshData data;
+    data.positions = {{0.0f, -0.5f}, {0.5f, 0.5f}, {-0.5f, 0.5f}};
+    data.colors = {{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}};
+    data.indices = {0, 1, 2};
+
+    return data;
+}
+
+MeshData make_grid_mesh(uint32_t triangle_count, JobSystem &job_system)
+{
+    TRACE_FUNCTION();
+
+    // Two triangles per cell, on the squarest grid that holds them all.
+    uint32_t cell_count = (triangle_count + 1) / 2;
+    uint32_t columns = std::max(1u, static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(cell_count)))));
+    uint32_t rows = std::max(1u, (cell_count + columns - 1) / columns);
+
+    MeshData data;
+    data.positions.resize((columns + 1) * (rows + 1));
+    data.colors.resize((columns + 1) * (rows + 1));
+    data.indices.resize(triangle_count * 3);
+
+    // Every row and every cell writes to its own slots, so both passes split freely across threads.
+    job_system.parallel_for(rows + 1, 16, [&data, columns, rows](uint32_t, uint32_t y)
+                            {
+                                for (uint32_t x = 0; x <= columns; x++)
+                                {
+                                    float u = static_cast<float>(x) / columns;
+                                    float v = static_cast<float>(y) / rows;
+
+                                    data.positions[y * (columns + 1) + x] = {u * 1.8f - 0.9f, v * 1.8f - 0.9f};
+                                    data.colors[y * (columns + 1) + x] = {u, v, 1.0f - u * v};
+                                } });
+
+    job_system.parallel_for(cell_count, 16384, [&data, columns](uint32_t, uint32_t cell)
+                            {
+                                uint32_t top_left = (cell / columns) * (columns + 1) + cell % columns;
+                                uint32_t bottom_left = top_left + columns + 1;
+                                uint32_t *indices = data.indices.data() + cell * 6;
+
+                                // Clockwise on screen like the triangle scene, the pipeline culls back faces.
+                                indices[0] = top_left;
+                                indices[1] = top_left + 1;
+                                indices[2] = bottom_left;
+
+                                // An odd triangle count leaves the last cell with only its first triangle.
+                                if (cell * 6 + 3 < data.indices.size())
+                                {
+                                    indices[3] = top_left + 1;
+                                    indices[4] = bottom_left + 1;
+                                    indices[5] = bottom_left;
+                                } });
+
+    return data;
+}
+
+std::vector<DrawBounds> compute_draw_bounds(const MeshData &data, const std::vector<DrawRange> &ranges, JobSystem &job_system)
+{
+    TRACE_FUNCTION();
+
+    std::vector<DrawBounds> bounds(ranges.size());
+
+    job_system.parallel_for(static_cast<uint32_t>(ranges.size()), 1, [&data, &ranges, &bounds](uint32_t, uint32_t range)
+                            {
+                                const uint32_t *indices = data.indices.data() + ranges[range].first_index;
+                                DrawBounds &box = bounds[range];
+
+                                box.min = box.max = data.positions[indices[0]];
+
+                                for (uint32_t i = 1; i < ranges[range].index_count; i++)
+                                {
+                                    box.min = glm::min(box.min, data.positions[indices[i]]);
+                                    box.max = glm::max(box.max, data.positions[indices[i]]);
+                                } });
+
+    return bounds;
+}
+
+void Mesh::create(MemoryAllocator &allocator, StagingRing &staging_ring, UploadScheduler &upload_scheduler, const MeshData &data, VertexLayout layout)
+{
+    TRACE_FUNCTION();
+
+    m_allocator = &allocator;
+    m_vertex_count = static_cast<uint32_t>(data.positions.size());
+    m_index_count = static_cast<uint32_t>(data.indices.size());
+    m_index_type = m_vertex_count <= UINT16_MAX + 1 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+
+    std::vector<char> vertex_data;
+
+    if (layout == VertexLayout::interleaved)
+    {
+        vertex_data.resize(m_vertex_count * sizeof(Vertex));
+
+        Vertex *vertices = reinterpret_cast<Vertex *>(vertex_data.data());
+        for (uint32_t i = 0; i < m_vertex_count; i++)
+            vertices[i] = {data.positions[i], data.colors[i]};
+
+        m_vertex_offsets = {0};
+    }
+    else
+    {
+        const VkDeviceSize positions_size = m_vertex_count * sizeof(glm::vec2);
+        const VkDeviceSize colors_size = m_vertex_count * sizeof(glm::vec3);
+
+        vertex_data.resize(positions_size + colors_size);
+        std::memcpy(vertex_data.data(), data.positions.data(), positions_size);
+        std::memcpy(vertex_data.data() + positions_size, data.colors.data(), colors_size);
+
+        m_vertex_offsets = {0, positions_size};
+    }
+
+    std::vector<char> index_data;
+
+    if (m_index_type == VK_INDEX_TYPE_UINT16)
+    {
+        index_data.resize(m_index_count * sizeof(uint16_t));
+
+        uint16_t *indices = reinterpret_cast<uint16_t *>(index_data.data());
+        for (uint32_t i = 0; i < m_index_count; i++)
+            indices[i] = static_cast<uint16_t>(data.indices[i]);
+    }
+    else
+    {
+        index_data.resize(m_index_count * sizeof(uint32_t));
+        std::memcpy(index_data.data(), data.indices.data(), index_data.size());
+    }
+
+    m_vertex_buffer = m_allocator->create_buffer(vertex_data.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    m_index_buffer = m_allocator->create_buffer(index_data.size(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    m_vertex_buffers.assign(m_vertex_offsets.size(), m_vertex_buffer.buffer);
+
+    // Small meshes ride along with the first frame's ring copies, anything else goes through the transfer queue. Both
+    // buffers take the same path, the ring's copies aren't ordered against the transfer queue's.
+    const StagingRing::BufferUpload uploads[] = {
+        {m_vertex_buffer.buffer, 0, vertex_data.data(), vertex_data.size()},
+        {m_index_buffer.buffer, 0, index_data.data(), index_data.size()},
+    };
+
+    const bool staged = vertex_data.size() + index_data.size() <= STAGING_RING_FRAME_SIZE / 2 && staging_ring.copy_to_buffers(uploads, std::size(uploads));
+
+    if (!staged)
+    {
+        upload_scheduler.upload_buffer(m_vertex_buffer.buffer, 0, vertex_data.data(), vertex_data.size(), VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+        upload_scheduler.upload_buffer(m_index_buffer.buffer, 0, index_data.data(), index_data.size(), VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+        upload_scheduler.flush();
+    }
+
+    SPDLOG_INFO("Mesh {}: {} vertices ({}), {} triangles ({} bit indices), {:.2f} MiB",
+                staged ? "staged" : "scheduled", m_vertex_count, layout == VertexLayout::interleaved ? "interleaved" : "deinterleaved", m_index_count / 3,
+                m_index_type == VK_INDEX_TYPE_UINT16 ? 16 : 32, (vertex_data.size() + index_data.size()) / 1048576.0);
+}
+
+void Mesh::destroy()
+{
+    if (m_allocator == nullptr)
+        return;
+
+    m_allocator->destroy_buffer(m_index_buffer);
+    m_allocator->destroy_buffer(m_vertex_buffer);
+    m_allocator = nullptr;
+}
+
+void Mesh::bind(VkCommandBuffer command_buffer) const
+{
+    vkCmdBindVertexBuffers(command_buffer, 0, static_cast<uint32_t>(m_vertex_buffers.size()), m_vertex_buffers.data(), m_vertex_offsets.data());
+    vkCmdBindIndexBuffer(command_buffer, m_index_buffer.buffer, 0, m_index_type);
+}
+
+void Mesh::draw(VkCommandBuffer command_buffer, uint32_t instance_count) const
+{
+    vkCmdDrawIndexed(command_buffer, m_index_count, instance_count, 0, 0, 0);
+}
+
+void Mesh::draw(VkCommandBuffer command_buffer, const DrawRange &range, uint32_t instance_count) const
+{
+    vkCmdDrawIndexed(command_buffer, range.index_count, instance_count, range.first_index, 0, 0);
+}
+
+std::vector<DrawRange> Mesh::draw_ranges(uint32_t draw_count) const
+{
+    const uint32_t triangle_count = m_index_count / 3;
+    draw_count = std::max(1u, std::min(draw_count, triangle_count));
+
+    std::vector<DrawRange> ranges;
+    ranges.reserve(draw_count);
+
+    for (uint32_t i = 0; i < draw_count; i++)
+    {
+        uint32_t first_triangle = static_cast<uint32_t>(static_cast<uint64_t>(triangle_count) * i / draw_count);
+        uint32_t last_triangle = static_cast<uint32_t>(static_cast<uint64_t>(triangle_count) * (i + 1) / draw_count);
+
+        ranges.push_back({first_triangle * 3, (last_triangle - first_triangle) * 3});
+    }
+
+    return ranges;
+}
+
+std::vector<VkVertexInputBindingDescription> Mesh::binding_descriptions(VertexLayout layout)
+{
+    if (layout == VertexLayout::interleaved)
+        return {{0, sizeof(Vertex), VK_VERTEX_INPUT_RATE_VERTEX}};
+
+    return {
+        {0, sizeof(glm::vec2), VK_VERTEX_INPUT_RATE_VERTEX},
+        {1, sizeof(glm::vec3), VK_VERTEX_INPUT_RATE_VERTEX},
+    };
+}
+
+std::vector<VkVertexInputAttributeDescription> Mesh::attribute_descriptions(VertexLayout layout)
+{
+    if (layout == VertexLayout::interleaved)
+        return {
+            {0, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, position)},
+            {1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color)},
+        };
+
+    return {
+        {0, 0, VK_FORMAT_R32G32_SFLOAT, 0},
+        {1, 1, VK_FORMAT_R32G32B32_SFLOAT, 0},
+    };
+}
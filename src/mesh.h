@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+
+#include "memory_allocator.h"
+#include "job_system.h"
+#include "options.h"
+#include "staging_ring.h"
+#include "upload_scheduler.h"
+
+struct Vertex
+{
+    glm::vec2 position;
+    glm::vec3 color;
+};
+
+struct DrawRange
+{
+    uint32_t first_index;
+    uint32_t index_count;
+};
+
+// Axis aligned box around everything a draw range touches, in the same space as the vertex positions.
+struct DrawBounds
+{
+    glm::vec2 min;
+    glm::vec2 max;
+};
+
+// Attributes are kept as separate streams here, Mesh packs them into whichever layout it's asked for.
+struct MeshData
+{
+    std::vector<glm::vec2> positions;
+    std::vector<glm::vec3> colors;
+    std::vector<uint32_t> indices;
+};
+
+MeshData make_triangle_mesh();
+MeshData make_grid_mesh(uint32_t triangle_count, JobSystem &job_system);
+
+std::vector<DrawBounds> compute_draw_bounds(const MeshData &data, const std::vector<DrawRange> &ranges, JobSystem &job_system);
+
+// Vertex and index data in device local buffers. Small meshes are uploaded through the staging ring, bigger ones through
+// the upload scheduler. Indices are stored as 16 bit whenever the vertex count allows it.
+class Mesh
+{
+public:
+    void create(MemoryAllocator &allocator, StagingRing &staging_ring, UploadScheduler &upload_scheduler, const MeshData &data, VertexLayout layout);
+    void destroy();
+
+    void bind(VkCommandBuffer command_buffer) const;
+    void draw(VkCommandBuffer command_buffer, uint32_t instance_count = 1) const;
+    void draw(VkCommandBuffer command_buffer, const DrawRange &range, uint32_t instance_count = 1) const;
+
+    // Splits the index buffer into draw_count ranges of whole triangles, as evenly as possible.
+    std::vector<DrawRange> draw_ranges(uint32_t draw_count) const;
+
+    static std::vector<VkVertexInputBindingDescription> binding_descriptions(VertexLayout layout);
+    static std::vector<VkVertexInputAttributeDescription> attribute_descriptions(VertexLayout layout);
+
+    uint32_t binding_count() const { return static_cast<uint32_t>(m_vertex_buffers.size()); }
+    uint32_t vertex_count() const { return m_vertex_count; }
+    uint32_t index_count() const { return m_index_count; }
+    VkIndexType index_type() const { return m_index_type; }
+
+private:
+    MemoryAllocator *m_allocator = nullptr;
+    Buffer m_vertex_buffer;
+    Buffer m_index_buffer;
+    std::vector<VkBuffer> m_vertex_buffers;
+    std::vector<VkDeviceSize> m_vertex_offsets;
+    uint32_t m_vertex_count = 0;
+    uint32_t m_index_count = 0;
+    VkIndexType m_index_type = VK_INDEX_TYPE_UINT32;
+};
@@ -0,0 +1,218 @@
+#include "options.h"
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include <spdlog/spdlog.h>
+
+static uint32_t parse_uint(const std::string &name, const std::string &value)
+{
+    // std::stoul skips whitespace and wraps a leading minus sign around, so only plain digits get that far.
+    try
+    {
+        size_t parsed = 0;
+        unsigned long result = !value.empty() && std::isdigit(static_cast<unsigned char>(value[0])) ? std::stoul(value, &parsed) : 0;
+
+        if (parsed > 0 && parsed == value.size() && result <= std::numeric_limits<uint32_t>::max())
+            return static_cast<uint32_t>(result);
+    }
+    catch (const std::exception &)
+    {
+    }
+
+    SPDLOG_ERROR("Invalid value for --{}: {}", name, value);
+    throw std::runtime_error("INVALID_COMMAND_LINE_OPTION");
+}
+
+static float parse_float(const std::string &name, const std::string &value)
+{
+    try
+    {
+        size_t parsed = 0;
+        float result = std::stof(value, &parsed);
+
+        if (parsed == value.size())
+            return result;
+    }
+    catch (const std::exception &)
+    {
+    }
+
+    SPDLOG_ERROR("Invalid value for --{}: {}", name, value);
+    throw std::runtime_error("INVALID_COMMAND_LINE_OPTION");
+}
+
+static PresentPolicy parse_present_policy(const std::string &name, const std::string &value)
+{
+    if (value == "vsync")
+        return PresentPolicy::vsync;
+    else if (value == "low-latency")
+        return PresentPolicy::low_latency;
+    else if (value == "uncapped")
+        return PresentPolicy::uncapped;
+    else if (value == "relaxed")
+        return PresentPolicy::relaxed;
+
+    SPDLOG_ERROR("Invalid value for --{}: {} (expected vsync, low-latency, uncapped or relaxed)", name, value);
+    throw std::runtime_error("INVALID_COMMAND_LINE_OPTION");
+}
+
+static HeadlessMode parse_headless_mode(const std::string &name, const std::string &value)
+{
+    if (value.empty() || value == "offscreen")
+        return HeadlessMode::offscreen;
+    else if (value == "surface")
+        return HeadlessMode::surface;
+
+    SPDLOG_ERROR("Invalid value for --{}: {} (expected offscreen or surface)", name, value);
+    throw std::runtime_error("INVALID_COMMAND_LINE_OPTION");
+}
+
+static VertexLayout parse_vertex_layout(const std::string &name, const std::string &value)
+{
+    if (value == "interleaved")
+        return VertexLayout::interleaved;
+    else if (value == "deinterleaved")
+        return VertexLayout::deinterleaved;
+
+    SPDLOG_ERROR("Invalid value for --{}: {} (expected interleaved or deinterleaved)", name, value);
+    throw std::runtime_error("INVALID_COMMAND_LINE_OPTION");
+}
+
+static DrawPath parse_draw_path(const std::string &name, const std::string &value)
+{
+    if (value == "direct")
+        return DrawPath::direct;
+    else if (value == "indirect")
+        return DrawPath::indirect;
+
+    SPDLOG_ERROR("Invalid value for --{}: {} (expected direct or indirect)", name, value);
+    throw std::runtime_error("INVALID_COMMAND_LINE_OPTION");
+}
+
+static const struct
+{
+    const char *name;
+    Scene scene;
+} scenes[] = {
+    {"triangle", Scene::triangle},
+    {"grid", Scene::grid},
+    {"instances", Scene::instances},
+};
+
+static Scene parse_scene(const std::string &name, const std::string &value)
+{
+    for (const auto &scene : scenes)
+        if (value == scene.name)
+            return scene.scene;
+
+    SPDLOG_ERROR("Invalid value for --{}: {}", name, value);
+    throw std::runtime_error("INVALID_COMMAND_LINE_OPTION");
+}
+
+const char *scene_name(Scene scene)
+{
+    for (const auto &entry : scenes)
+        if (entry.scene == scene)
+            return entry.name;
+
+    return "unknown";
+}
+
+Options parse_options(int argc, char **argv)
+{
+    Options options;
+
+    for (auto i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+
+        if (argument.rfind("--", 0) != 0)
+        {
+            SPDLOG_ERROR("Unexpected argument: {}", argument);
+            throw std::runtime_error("INVALID_COMMAND_LINE_OPTION");
+        }
+
+        auto separator = argument.find('=');
+        std::string name = argument.substr(2, separator == std::string::npos ? std::string::npos : separator - 2);
+        std::string value = separator == std::string::npos ? std::string() : argument.substr(separator + 1);
+
+        if (name == "resize-storm")
+            options.resize_storm = parse_uint(name, value);
+        else if (name == "present-mode")
+            options.present_policy = parse_present_policy(name, value);
+        else if (name == "headless")
+            options.headless = parse_headless_mode(name, value);
+        else if (name == "frames")
+            options.frames = parse_uint(name, value);
+        else if (name == "trace")
+            options.trace_path = value.empty() ? PROJECT_NAME ".trace.json" : value;
+        else if (name == "benchmark")
+            options.benchmark = true;
+        else if (name == "warmup-frames")
+            options.warmup_frames = parse_uint(name, value);
+        else if (name == "scene")
+            options.scene = parse_scene(name, value);
+        else if (name == "report")
+            options.report_path = value;
+        else if (name == "vertex-layout")
+            options.vertex_layout = parse_vertex_layout(name, value);
+        else if (name == "draws")
+            options.draws = std::max(1u, parse_uint(name, value));
+        else if (name == "draw-path")
+            options.draw_path = parse_draw_path(name, value);
+        else if (name == "worker-threads")
+            options.worker_threads = parse_uint(name, value);
+        else if (name == "zoom")
+        {
+            options.zoom = parse_float(name, value);
+
+            if (!(options.zoom > 0.0f))
+            {
+                SPDLOG_ERROR("Invalid value for --{}: {} (expected a positive factor)", name, value);
+                throw std::runtime_error("INVALID_COMMAND_LINE_OPTION");
+            }
+        }
+        else if (name == "instances")
+        {
+            options.instances = parse_uint(name, value);
+
+            if (options.instances == 0)
+            {
+                SPDLOG_ERROR("Invalid value for --{}: {} (expected at least one instance)", name, value);
+                throw std::runtime_error("INVALID_COMMAND_LINE_OPTION");
+            }
+        }
+        else if (name == "triangles")
+        {
+            options.triangles = parse_uint(name, value);
+
+            if (options.triangles == 0)
+            {
+                SPDLOG_ERROR("Invalid value for --{}: {} (expected at least one triangle)", name, value);
+                throw std::runtime_error("INVALID_COMMAND_LINE_OPTION");
+            }
+        }
+        else
+        {
+            SPDLOG_ERROR("Unknown option: --{}", name);
+            throw std::runtime_error("UNKNOWN_COMMAND_LINE_OPTION");
+        }
+    }
+
+#ifdef BENCHMARK_MODE
+    options.benchmark = true;
+#endif
+
+    if (options.benchmark && options.frames == 0)
+        options.frames = BENCHMARK_FRAMES;
+
+    // Nothing closes a headless run, so it always needs a frame budget.
+    if (options.headless != HeadlessMode::none && options.frames == 0)
+        options.frames = HEADLESS_FRAME_COUNT;
+
+    return options;
+}
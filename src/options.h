@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "HelloVulkan_config.h"
+
+enum class PresentPolicy
+{
+    vsync,
+    low_latency,
+    uncapped,
+    relaxed,
+};
+
+enum class HeadlessMode
+{
+    none,
+    offscreen,
+    surface,
+};
+
+enum class Scene
+{
+    triangle,
+    grid,
+    instances,
+};
+
+enum class VertexLayout
+{
+    interleaved,
+    deinterleaved,
+};
+
+enum class DrawPath
+{
+    direct,
+    indirect,
+};
+
+struct Options
+{
+    uint32_t resize_storm = 0;
+    PresentPolicy present_policy = PresentPolicy::vsync;
+    HeadlessMode headless = HeadlessMode::none;
+    uint32_t frames = 0;
+    std::string trace_path;
+    bool benchmark = false;
+    uint32_t warmup_frames = BENCHMARK_WARMUP_FRAMES;
+    Scene scene = Scene::triangle;
+    std::string report_path = PROJECT_NAME "_Benchmark.json";
+    VertexLayout vertex_layout = VertexLayout::interleaved;
+    uint32_t triangles = GRID_TRIANGLES;
+    uint32_t instances = INSTANCE_COUNT;
+    uint32_t draws = 1;
+    DrawPath draw_path = DrawPath::direct;
+    float zoom = 1.0f;
+    uint32_t worker_threads = 0;
+};
+
+Options parse_options(int argc, char **argv);
+
+const char *scene_name(Scene scene);
@@ -0,0 +1,221 @@
+#include "pipeline_cache.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "HelloVulkan_config.h"
+
+void PipelineCache::create(VkPhysicalDevice physical_device, VkDevice device, const std::string &path)
+{
+    m_device = device;
+    m_path = path;
+    vkGetPhysicalDeviceProperties(physical_device, &m_device_properties);
+
+    std::vector<char> initial_data = load_file_data();
+
+    VkPipelineCacheCreateInfo create_info{};
+    create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    create_info.initialDataSize = initial_data.size();
+    create_info.pInitialData = initial_data.empty() ? nullptr : initial_data.data();
+
+    if (vkCreatePipelineCache(m_device, &create_info, nullptr, &m_pipeline_cache) != VK_SUCCESS)
+    {
+        SPDLOG_WARN("Pipeline cache data rejected by the driver, starting cold");
+
+        create_info.initialDataSize = 0;
+        create_info.pInitialData = nullptr;
+
+        if (vkCreatePipelineCache(m_device, &create_info, nullptr, &m_pipeline_cache) != VK_SUCCESS)
+            throw std::runtime_error("VULKAN_CREATE_PIPELINE_CACHE_FAILURE");
+
+        initial_data.clear();
+    }
+
+    m_warm = !initial_data.empty();
+    m_loaded_size = initial_data.size();
+}
+
+std::string PipelineCache::resolve_path(const std::string &file_name)
+{
+    if (std::filesystem::path(file_name).is_absolute())
+        return file_name;
+
+    std::filesystem::path directory;
+
+    if (const char *cache_home = std::getenv("XDG_CACHE_HOME"); cache_home != nullptr && *cache_home != '\0')
+        directory = std::filesystem::path(cache_home) / PROJECT_NAME;
+    else if (const char *home = std::getenv("HOME"); home != nullptr && *home != '\0')
+        directory = std::filesystem::path(home) / ".cache" / PROJECT_NAME;
+    else if (const char *local_app_data = std::getenv("LOCALAPPDATA"); local_app_data != nullptr && *local_app_data != '\0')
+        directory = std::filesystem::path(local_app_data) / PROJECT_NAME;
+    else
+    {
+        // Without a home directory the cache goes next to the executable, wherever the process was started from.
+        std::error_code error;
+        directory = std::filesystem::read_symlink("/proc/self/exe", error).parent_path();
+    }
+
+    return (directory / file_name).string();
+}
+
+void PipelineCache::destroy()
+{
+    if (m_pipeline_cache == VK_NULL_HANDLE)
+        return;
+
+    save();
+
+    vkDestroyPipelineCache(m_device, m_pipeline_cache, nullptr);
+    m_pipeline_cache = VK_NULL_HANDLE;
+}
+
+void PipelineCache::save()
+{
+    size_t data_size = 0;
+    if (vkGetPipelineCacheData(m_device, m_pipeline_cache, &data_size, nullptr) != VK_SUCCESS || data_size == 0)
+        return;
+
+    std::vector<char> data(data_size);
+    if (vkGetPipelineCacheData(m_device, m_pipeline_cache, &data_size, data.data()) != VK_SUCCESS)
+    {
+        SPDLOG_WARN("Couldn't read back pipeline cache data");
+        return;
+    }
+
+    data.resize(data_size);
+
+    FileHeader header = make_header();
+    header.data_size = data.size();
+    header.data_hash = hash(data.data(), data.size());
+
+    // The cache directory doesn't exist before the first run.
+    std::error_code error;
+    const std::filesystem::path directory = std::filesystem::path(m_path).parent_path();
+
+    if (!directory.empty() && !std::filesystem::create_directories(directory, error) && error)
+    {
+        SPDLOG_WARN("Couldn't create pipeline cache directory {}: {}", directory.string(), error.message());
+        return;
+    }
+
+    // Write next to the destination and rename over it, so a crash mid-write never leaves a truncated cache behind.
+    const std::string temporary_path = m_path + ".tmp";
+
+    {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+
+        if (!file.is_open())
+        {
+            SPDLOG_WARN("Couldn't open pipeline cache for writing: {}", temporary_path);
+            return;
+        }
+
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(data.data(), data.size());
+
+        if (!file.good())
+        {
+            SPDLOG_WARN("Couldn't write pipeline cache: {}", temporary_path);
+            return;
+        }
+    }
+
+    std::filesystem::rename(temporary_path, m_path, error);
+
+    if (error)
+    {
+        SPDLOG_WARN("Couldn't replace pipeline cache {}: {}", m_path, error.message());
+        std::filesystem::remove(temporary_path, error);
+        return;
+    }
+
+    SPDLOG_TRACE("Pipeline cache saved: {} ({} bytes)", m_path, data.size());
+}
+
+std::vector<char> PipelineCache::load_file_data()
+{
+    std::ifstream file(m_path, std::ios::ate | std::ios::binary);
+
+    if (!file.is_open())
+    {
+        SPDLOG_INFO("No pipeline cache found at {}, starting cold", m_path);
+        return {};
+    }
+
+    size_t file_size = (size_t)file.tellg();
+
+    if (file_size < sizeof(FileHeader))
+    {
+        SPDLOG_WARN("Pipeline cache {} is truncated, starting cold", m_path);
+        return {};
+    }
+
+    FileHeader header;
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+
+    const FileHeader expected = make_header();
+
+    if (header.magic != expected.magic || header.version != expected.version)
+    {
+        SPDLOG_WARN("Pipeline cache {} has an unknown format, starting cold", m_path);
+        return {};
+    }
+
+    if (header.vendor_id != expected.vendor_id || header.device_id != expected.device_id ||
+        header.driver_version != expected.driver_version ||
+        std::memcmp(header.pipeline_cache_uuid, expected.pipeline_cache_uuid, VK_UUID_SIZE) != 0)
+    {
+        SPDLOG_INFO("Pipeline cache {} belongs to a different device or driver, starting cold", m_path);
+        return {};
+    }
+
+    if (header.data_size != file_size - sizeof(FileHeader))
+    {
+        SPDLOG_WARN("Pipeline cache {} is truncated, starting cold", m_path);
+        return {};
+    }
+
+    std::vector<char> data(header.data_size);
+    file.read(data.data(), data.size());
+
+    if (!file.good() || hash(data.data(), data.size()) != header.data_hash)
+    {
+        SPDLOG_WARN("Pipeline cache {} is corrupted, starting cold", m_path);
+        return {};
+    }
+
+    return data;
+}
+
+PipelineCache::FileHeader PipelineCache::make_header() const
+{
+    FileHeader header{};
+    header.magic = FILE_MAGIC;
+    header.version = FILE_VERSION;
+    header.vendor_id = m_device_properties.vendorID;
+    header.device_id = m_device_properties.deviceID;
+    header.driver_version = m_device_properties.driverVersion;
+    std::memcpy(header.pipeline_cache_uuid, m_device_properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+    return header;
+}
+
+uint64_t PipelineCache::hash(const char *data, size_t size)
+{
+    // FNV-1a, enough to catch truncation and bit rot.
+    uint64_t value = 0xcbf29ce484222325ull;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        value ^= static_cast<uint8_t>(data[i]);
+        value *= 0x100000001b3ull;
+    }
+
+    return value;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+class PipelineCache
+{
+public:
+    void create(VkPhysicalDevice physical_device, VkDevice device, const std::string &path);
+    void destroy();
+
+    void save();
+
+    // Where a cache file of that name lives: the per-user cache directory ($XDG_CACHE_HOME, ~/.cache or
+    // %LOCALAPPDATA%) when there is one, otherwise next to the executable. Absolute names are kept as they are.
+    static std::string resolve_path(const std::string &file_name);
+
+    VkPipelineCache handle() const { return m_pipeline_cache; }
+    bool is_warm() const { return m_warm; }
+    size_t loaded_size() const { return m_loaded_size; }
+
+private:
+    // Prefixed to the driver blob so a cache written by another device or driver is rejected before it reaches vkCreatePipelineCache.
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendor_id;
+        uint32_t device_id;
+        uint32_t driver_version;
+        uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+        uint64_t data_size;
+        uint64_t data_hash;
+    };
+
+    static constexpr uint32_t FILE_MAGIC = 0x43505648; // "HVPC"
+    static constexpr uint32_t FILE_VERSION = 1;
+
+    std::vector<char> load_file_data();
+    FileHeader make_header() const;
+
+    static uint64_t hash(const char *data, size_t size);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties m_device_properties{};
+    VkPipelineCache m_pipeline_cache = VK_NULL_HANDLE;
+    std::string m_path;
+    bool m_warm = false;
+    size_t m_loaded_size = 0;
+};
@@ -0,0 +1,194 @@
+#ifdef HOT_RELOAD
+
+#include "shader_reloader.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <stdexcept>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <shaderc/shaderc.h>
+#include <spdlog/spdlog.h>
+
+static bool shader_kind(const std::string &name, shaderc_shader_kind &kind)
+{
+    static const std::pair<const char *, shaderc_shader_kind> kinds[] = {
+        {".vert", shaderc_vertex_shader},
+        {".frag", shaderc_fragment_shader},
+        {".comp", shaderc_compute_shader},
+        {".geom", shaderc_geometry_shader},
+        {".tesc", shaderc_tess_control_shader},
+        {".tese", shaderc_tess_evaluation_shader},
+    };
+
+    for (const auto &[extension, extension_kind] : kinds)
+    {
+        const size_t length = std::strlen(extension);
+
+        if (name.size() > length && name.compare(name.size() - length, length, extension) == 0)
+        {
+            kind = extension_kind;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ShaderReloader::create(const std::string &source_directory)
+{
+    m_source_directory = source_directory;
+
+    m_compiler = shaderc_compiler_initialize();
+    if (m_compiler == nullptr)
+        throw std::runtime_error("SHADERC_INITIALIZE_FAILURE");
+
+    // Saving in place closes the file after writing, saving through a temporary renames it over the original.
+    m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotify < 0 || inotify_add_watch(m_inotify, m_source_directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        SPDLOG_ERROR("Couldn't watch {}: {}", m_source_directory, std::strerror(errno));
+        throw std::runtime_error("INOTIFY_WATCH_FAILURE");
+    }
+
+    m_stop_event = eventfd(0, EFD_CLOEXEC);
+    if (m_stop_event < 0)
+        throw std::runtime_error("EVENTFD_CREATE_FAILURE");
+
+    m_thread = std::thread(&ShaderReloader::watch, this);
+
+    SPDLOG_INFO("Shader hot reload: watching {}", m_source_directory);
+}
+
+void ShaderReloader::destroy()
+{
+    if (m_compiler == nullptr)
+        return;
+
+    if (m_thread.joinable())
+    {
+        const uint64_t stop = 1;
+        if (write(m_stop_event, &stop, sizeof(stop)) != sizeof(stop))
+            SPDLOG_ERROR("Couldn't stop the shader watcher: {}", std::strerror(errno));
+
+        m_thread.join();
+    }
+
+    close(m_stop_event);
+    close(m_inotify);
+    shaderc_compiler_release(m_compiler);
+
+    m_stop_event = -1;
+    m_inotify = -1;
+    m_compiler = nullptr;
+}
+
+std::vector<ShaderReloader::CompiledShader> ShaderReloader::take_compiled()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<CompiledShader> compiled;
+    compiled.swap(m_compiled);
+
+    return compiled;
+}
+
+void ShaderReloader::watch()
+{
+    pollfd descriptors[2] = {{m_inotify, POLLIN, 0}, {m_stop_event, POLLIN, 0}};
+    alignas(inotify_event) char events[4096];
+    std::set<std::string> changed;
+
+    while (true)
+    {
+        const int ready = poll(descriptors, 2, changed.empty() ? -1 : SETTLE_MILLISECONDS);
+
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            SPDLOG_ERROR("Shader watcher stopped: {}", std::strerror(errno));
+            return;
+        }
+
+        if (descriptors[1].revents & POLLIN)
+            return;
+
+        if (ready == 0)
+        {
+            for (const auto &name : changed)
+            {
+                std::vector<uint32_t> code;
+                if (!compile(name, code))
+                    continue;
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_compiled.push_back({name, std::move(code)});
+            }
+
+            changed.clear();
+            continue;
+        }
+
+        const ssize_t length = read(m_inotify, events, sizeof(events));
+
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const inotify_event *event = reinterpret_cast<const inotify_event *>(events + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            shaderc_shader_kind kind;
+            if (event->len > 0 && shader_kind(event->name, kind))
+                changed.insert(event->name);
+        }
+    }
+}
+
+bool ShaderReloader::compile(const std::string &name, std::vector<uint32_t> &code) const
+{
+    shaderc_shader_kind kind;
+    shader_kind(name, kind);
+
+    std::ifstream file(m_source_directory + "/" + name, std::ios::binary);
+    if (!file.is_open())
+    {
+        SPDLOG_WARN("Couldn't read changed shader {}", name);
+        return false;
+    }
+
+    const std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    auto compile_start = std::chrono::steady_clock::now();
+
+    // No options, so a reloaded shader comes out the same as the glslc build step would have produced it.
+    shaderc_compilation_result_t result = shaderc_compile_into_spv(m_compiler, source.data(), source.size(), kind, name.c_str(), "main", nullptr);
+
+    const bool compiled = shaderc_result_get_compilation_status(result) == shaderc_compilation_status_success;
+
+    if (compiled)
+    {
+        // SPIR-V is a whole number of words, copied out so the module sees them aligned.
+        code.resize(shaderc_result_get_length(result) / sizeof(uint32_t));
+        std::memcpy(code.data(), shaderc_result_get_bytes(result), code.size() * sizeof(uint32_t));
+
+        std::chrono::duration<double, std::milli> compile_duration = std::chrono::steady_clock::now() - compile_start;
+        SPDLOG_INFO("Recompiled {} in {:.1f} ms", name, compile_duration.count());
+    }
+    else
+        SPDLOG_ERROR("Couldn't recompile {}:\n{}", name, shaderc_result_get_error_message(result));
+
+    shaderc_result_release(result);
+
+    return compiled;
+}
+
+#endif
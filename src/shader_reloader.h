@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct shaderc_compiler;
+
+// Development aid, only built with the HOT_RELOAD CMake option. A background thread watches the shader source directory
+// with inotify and compiles every GLSL file written there to SPIR-V with shaderc. The render loop takes the results
+// between frames and swaps the pipelines that use them, a shader that fails to compile is logged and left as it was.
+class ShaderReloader
+{
+public:
+    struct CompiledShader
+    {
+        // Source file name, e.g. "shader.vert".
+        std::string name;
+        std::vector<uint32_t> code;
+    };
+
+    void create(const std::string &source_directory);
+    void destroy();
+
+    // Shaders compiled since the last call, in the order they finished.
+    std::vector<CompiledShader> take_compiled();
+
+private:
+    // Editors tend to save a file in several writes, so changes are collected until the directory has been quiet this long.
+    static constexpr int SETTLE_MILLISECONDS = 50;
+
+    void watch();
+    bool compile(const std::string &name, std::vector<uint32_t> &code) const;
+
+    std::string m_source_directory;
+    int m_inotify = -1;
+    int m_stop_event = -1;
+    shaderc_compiler *m_compiler = nullptr;
+    std::thread m_thread;
+
+    std::mutex m_mutex;
+    std::vector<CompiledShader> m_compiled;
+};
@@ -1,9 +1,34 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragUv;
+layout(location = 2) flat in uint fragMaterial;
 
 layout(location = 0) out vec4 outColor;
 
+struct Material {
+    vec4 color;
+    uint texture;
+};
+
+// The bindless heap, see BindlessHeap.
+layout(set = 0, binding = 0) uniform sampler2D textures[];
+
+layout(std430, set = 0, binding = 1) readonly buffer MaterialBuffer {
+    Material materials[];
+} buffers[];
+
+layout(push_constant) uniform PushConstants {
+    mat4 model;
+    uint materialBuffer;
+} pushConstants;
+
 void main() {
-    outColor = vec4(fragColor, 1.0);
+    Material material = buffers[pushConstants.materialBuffer].materials[fragMaterial];
+
+    // Neighbouring fragments can belong to instances with different materials.
+    vec3 texel = texture(textures[nonuniformEXT(material.texture)], fragUv).rgb;
+
+    outColor = vec4(fragColor * material.color.rgb * texel, 1.0);
 }
\ No newline at end of file
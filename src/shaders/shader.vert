@@ -1,20 +1,35 @@
 #version 450
 
-vec2 positions[3] = vec2[](
-    vec2(0.0, -0.5),
-    vec2(0.5, 0.5),
-    vec2(-0.5, 0.5)
-);
-
-vec3 colors[3] = vec3[](
-    vec3(1.0, 0.0, 0.0),
-    vec3(0.0, 1.0, 0.0),
-    vec3(0.0, 0.0, 1.0)
-);
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec4 inTint;
+layout(location = 3) in vec4 inTransform;
+layout(location = 4) in vec3 inInstanceColor;
+layout(location = 5) in uint inMaterial;
 
 layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragUv;
+layout(location = 2) flat out uint fragMaterial;
+
+// Sits at a dynamic offset into the uniform ring, see UniformRing.
+layout(set = 1, binding = 0) uniform FrameUniforms {
+    mat4 viewProjection;
+    float time;
+} frame;
+
+layout(push_constant) uniform PushConstants {
+    mat4 model;
+    uint materialBuffer;
+} pushConstants;
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-    fragColor = colors[gl_VertexIndex];
+    // Offset, scale and rotation around the instance's centre.
+    float c = cos(inTransform.w);
+    float s = sin(inTransform.w);
+    vec2 position = inTransform.xy + inTransform.z * (mat2(c, s, -s, c) * inPosition);
+
+    gl_Position = frame.viewProjection * pushConstants.model * vec4(position, 0.0, 1.0);
+    fragColor = inColor * inTint.rgb * inInstanceColor;
+    fragUv = inPosition * 4.0;
+    fragMaterial = inMaterial;
 }
\ No newline at end of file
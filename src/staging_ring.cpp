@@ -0,0 +1,203 @@
+#include "staging_ring.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "trace.h"
+
+void StagingRing::create(MemoryAllocator &allocator, VkDevice device, VkDeviceSize frame_size, uint32_t frame_count)
+{
+    m_allocator = &allocator;
+    m_device = device;
+    m_size = frame_size * frame_count;
+    m_head = 0;
+    m_tail = 0;
+    m_frame_heads.assign(frame_count, 0);
+
+    m_buffer = m_allocator->create_buffer(m_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    if (m_buffer.allocation.mapped == nullptr)
+        throw std::runtime_error("VULKAN_MAP_MEMORY_FAILURE");
+}
+
+void StagingRing::destroy()
+{
+    if (m_allocator == nullptr)
+        return;
+
+    SPDLOG_INFO("Staging ring: {:.2f} of {:.2f} MiB used at most, {} uploads didn't fit", m_high_water_mark / 1048576.0, m_size / 1048576.0, m_rejected_uploads);
+
+    m_allocator->destroy_buffer(m_buffer);
+    m_allocator = nullptr;
+}
+
+void StagingRing::begin_frame(uint32_t frame)
+{
+    m_tail = std::max(m_tail, m_frame_heads[frame]);
+}
+
+void StagingRing::end_frame(uint32_t frame)
+{
+    m_frame_heads[frame] = m_head;
+}
+
+bool StagingRing::copy_to_buffer(VkBuffer buffer, VkDeviceSize offset, const void *data, VkDeviceSize size)
+{
+    VkDeviceSize source_offset;
+    if (!allocate(size, 4, source_offset))
+        return false;
+
+    write(source_offset, data, size);
+    m_buffer_copies.push_back({buffer, {source_offset, offset, size}});
+
+    return true;
+}
+
+bool StagingRing::copy_to_buffers(const BufferUpload *uploads, size_t upload_count)
+{
+    const uint64_t head = m_head;
+    const uint64_t high_water_mark = m_high_water_mark;
+    const size_t first_copy = m_buffer_copies.size();
+
+    for (size_t i = 0; i < upload_count; i++)
+    {
+        VkDeviceSize source_offset;
+        if (!allocate(uploads[i].size, 4, source_offset))
+        {
+            // Gives back the space of the uploads that did fit, none of them has been written yet.
+            m_head = head;
+            m_high_water_mark = high_water_mark;
+            m_buffer_copies.resize(first_copy);
+            return false;
+        }
+
+        m_buffer_copies.push_back({uploads[i].buffer, {source_offset, uploads[i].offset, uploads[i].size}});
+    }
+
+    for (size_t i = 0; i < upload_count; i++)
+        write(m_buffer_copies[first_copy + i].region.srcOffset, uploads[i].data, uploads[i].size);
+
+    return true;
+}
+
+bool StagingRing::copy_to_image(VkImage image, const VkBufferImageCopy &region, const void *data, VkDeviceSize size, VkDeviceSize alignment)
+{
+    // bufferOffset has to be a multiple of both the texel block size and 4.
+    VkDeviceSize source_offset;
+    if (!allocate(size, std::max<VkDeviceSize>(alignment, 4), source_offset))
+        return false;
+
+    write(source_offset, data, size);
+
+    ImageCopy copy{image, region};
+    copy.region.bufferOffset = source_offset;
+    m_image_copies.push_back(copy);
+
+    return true;
+}
+
+bool StagingRing::record(VkCommandBuffer command_buffer)
+{
+    if (!has_pending_copies())
+        return false;
+
+    TRACE_FUNCTION();
+
+    // Group regions by destination, the sort is stable so copies into the same range keep their order.
+    std::stable_sort(m_buffer_copies.begin(), m_buffer_copies.end(), [](const BufferCopy &a, const BufferCopy &b)
+                     { return a.buffer < b.buffer; });
+
+    for (size_t first = 0; first < m_buffer_copies.size();)
+    {
+        size_t last = first;
+
+        m_regions.clear();
+        while (last < m_buffer_copies.size() && m_buffer_copies[last].buffer == m_buffer_copies[first].buffer)
+            m_regions.push_back(m_buffer_copies[last++].region);
+
+        vkCmdCopyBuffer(command_buffer, m_buffer.buffer, m_buffer_copies[first].buffer, static_cast<uint32_t>(m_regions.size()), m_regions.data());
+
+        first = last;
+    }
+
+    // One transition per image, however many regions it's copied in.
+    m_image_barriers.clear();
+    for (const auto &copy : m_image_copies)
+    {
+        if (std::any_of(m_image_barriers.begin(), m_image_barriers.end(), [&copy](const VkImageMemoryBarrier &barrier)
+                        { return barrier.image == copy.image; }))
+            continue;
+
+        VkImageMemoryBarrier image_barrier{};
+        image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        image_barrier.srcAccessMask = 0;
+        image_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        image_barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        image_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        image_barrier.image = copy.image;
+        image_barrier.subresourceRange = {copy.region.imageSubresource.aspectMask, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
+
+        m_image_barriers.push_back(image_barrier);
+    }
+
+    if (!m_image_barriers.empty())
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+                             static_cast<uint32_t>(m_image_barriers.size()), m_image_barriers.data());
+
+    for (const auto &copy : m_image_copies)
+        vkCmdCopyBufferToImage(command_buffer, m_buffer.buffer, copy.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy.region);
+
+    for (auto &image_barrier : m_image_barriers)
+    {
+        image_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        image_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        image_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        image_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    }
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0, 1, &barrier, 0, nullptr, static_cast<uint32_t>(m_image_barriers.size()), m_image_barriers.data());
+
+    m_buffer_copies.clear();
+    m_image_copies.clear();
+
+    return true;
+}
+
+bool StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset)
+{
+    uint64_t head = (m_head + alignment - 1) / alignment * alignment;
+
+    // Allocations never straddle the end of the ring, the space up to it is skipped instead.
+    if (head % m_size + size > m_size)
+        head += m_size - head % m_size;
+
+    if (size > m_size || head + size - m_tail > m_size)
+    {
+        m_rejected_uploads++;
+        return false;
+    }
+
+    offset = head % m_size;
+    m_head = head + size;
+    m_high_water_mark = std::max(m_high_water_mark, m_head - m_tail);
+
+    return true;
+}
+
+void StagingRing::write(VkDeviceSize offset, const void *data, VkDeviceSize size)
+{
+    std::memcpy(static_cast<char *>(m_buffer.allocation.mapped) + offset, data, size);
+    m_allocator->flush(m_buffer.allocation, offset, size);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "memory_allocator.h"
+
+// A persistently mapped, host visible ring that upload data is written into and copied out of on the GPU timeline.
+// Space is handed out front to back and given back a whole frame at a time once that frame's fence has signalled, so
+// streaming data never allocates anything.
+class StagingRing
+{
+public:
+    struct BufferUpload
+    {
+        VkBuffer buffer;
+        VkDeviceSize offset;
+        const void *data;
+        VkDeviceSize size;
+    };
+
+    void create(MemoryAllocator &allocator, VkDevice device, VkDeviceSize frame_size, uint32_t frame_count);
+    void destroy();
+
+    // Everything written since the frame last ran is known to be consumed once its fence has been waited on.
+    void begin_frame(uint32_t frame);
+    void end_frame(uint32_t frame);
+
+    // Both return false when the ring can't hold the data this frame, the caller has to take another path then.
+    bool copy_to_buffer(VkBuffer buffer, VkDeviceSize offset, const void *data, VkDeviceSize size);
+    bool copy_to_image(VkImage image, const VkBufferImageCopy &region, const void *data, VkDeviceSize size, VkDeviceSize alignment);
+
+    // All or nothing, nothing is copied unless the ring can hold every upload this frame. Data that has to arrive
+    // together then never ends up split between the ring and another path.
+    bool copy_to_buffers(const BufferUpload *uploads, size_t upload_count);
+
+    // Records the pending copies, one vkCmdCopyBuffer per destination buffer, and a barrier that makes them visible to
+    // the vertex input, vertex shader and fragment shader stages. Images go from UNDEFINED to TRANSFER_DST_OPTIMAL
+    // before their copies and end up in SHADER_READ_ONLY_OPTIMAL, so they must be uploaded whole and not in use yet.
+    bool record(VkCommandBuffer command_buffer);
+
+    bool has_pending_copies() const { return !m_buffer_copies.empty() || !m_image_copies.empty(); }
+
+private:
+    struct BufferCopy
+    {
+        VkBuffer buffer;
+        VkBufferCopy region;
+    };
+
+    struct ImageCopy
+    {
+        VkImage image;
+        VkBufferImageCopy region;
+    };
+
+    bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset);
+    void write(VkDeviceSize offset, const void *data, VkDeviceSize size);
+
+    MemoryAllocator *m_allocator = nullptr;
+    VkDevice m_device = VK_NULL_HANDLE;
+    Buffer m_buffer;
+    VkDeviceSize m_size = 0;
+
+    // Both count bytes ever handed out, the ring offset is the value modulo m_size.
+    uint64_t m_head = 0;
+    uint64_t m_tail = 0;
+    std::vector<uint64_t> m_frame_heads;
+
+    std::vector<BufferCopy> m_buffer_copies;
+    std::vector<ImageCopy> m_image_copies;
+    std::vector<VkBufferCopy> m_regions;
+    std::vector<VkImageMemoryBarrier> m_image_barriers;
+
+    uint64_t m_high_water_mark = 0;
+    uint64_t m_rejected_uploads = 0;
+};
@@ -0,0 +1,42 @@
+#include "statistics.h"
+
+#include <algorithm>
+#include <cmath>
+
+static double percentile(const std::vector<double> &sorted_samples, double fraction)
+{
+    // Nearest-rank, so the reported value is always one that was actually measured.
+    size_t rank = static_cast<size_t>(std::ceil(fraction * sorted_samples.size()));
+
+    return sorted_samples[std::clamp<size_t>(rank, 1, sorted_samples.size()) - 1];
+}
+
+Statistics compute_statistics(std::vector<double> samples)
+{
+    Statistics statistics;
+
+    if (samples.empty())
+        return statistics;
+
+    std::sort(samples.begin(), samples.end());
+
+    double sum = 0.0;
+    for (auto sample : samples)
+        sum += sample;
+
+    statistics.count = samples.size();
+    statistics.min = samples.front();
+    statistics.max = samples.back();
+    statistics.mean = sum / samples.size();
+    statistics.median = percentile(samples, 0.5);
+    statistics.p95 = percentile(samples, 0.95);
+    statistics.p99 = percentile(samples, 0.99);
+
+    double squared_deviations = 0.0;
+    for (auto sample : samples)
+        squared_deviations += (sample - statistics.mean) * (sample - statistics.mean);
+
+    statistics.stddev = std::sqrt(squared_deviations / samples.size());
+
+    return statistics;
+}
@@ -0,0 +1,92 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+#include <spdlog/spdlog.h>
+
+#include "HelloVulkan_config.h"
+
+static std::chrono::steady_clock::time_point trace_origin;
+
+void Trace::enable(size_t capacity)
+{
+    s_events = std::make_unique<Event[]>(capacity);
+    s_capacity = capacity;
+    s_next_event = 0;
+    trace_origin = std::chrono::steady_clock::now();
+    s_enabled = true;
+}
+
+uint64_t Trace::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - trace_origin).count();
+}
+
+void Trace::record(Track track, const char *name, uint64_t start, uint64_t duration)
+{
+    Event &event = s_events[s_next_event.fetch_add(1, std::memory_order_relaxed) % s_capacity];
+
+    std::strncpy(event.name, name, sizeof(event.name) - 1);
+    event.name[sizeof(event.name) - 1] = '\0';
+    event.start = start;
+    event.duration = duration;
+    event.thread = track == Track::gpu ? 0 : thread_index() + 1;
+    event.track = track;
+}
+
+void Trace::write(const std::string &path)
+{
+    if (!s_enabled)
+        return;
+
+    std::ofstream file(path, std::ios::trunc);
+
+    if (!file.is_open())
+    {
+        SPDLOG_ERROR("Couldn't open trace file for writing: {}", path);
+        return;
+    }
+
+    // Only meant to be called once recording threads are idle, the ring isn't guarded against concurrent writers.
+    uint64_t next_event = s_next_event.load();
+    uint64_t event_count = std::min<uint64_t>(next_event, s_capacity);
+    uint64_t first_event = next_event - event_count;
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"" PROJECT_NAME "\"}},\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}}";
+
+    for (uint32_t i = 0; i < s_next_thread.load(); i++)
+        file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i + 1 << ",\"args\":{\"name\":\"Thread " << i << "\"}}";
+
+    for (uint64_t i = first_event; i < next_event; i++)
+    {
+        const Event &event = s_events[i % s_capacity];
+
+        file << ",\n{\"name\":\"";
+        for (const char *c = event.name; *c; c++)
+        {
+            if (*c == '"' || *c == '\\')
+                file << '\\';
+            file << *c;
+        }
+
+        file << "\",\"cat\":\"" << (event.track == Track::gpu ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+             << ",\"ts\":" << event.start / 1000 << '.' << fmt::format("{:03}", event.start % 1000)
+             << ",\"dur\":" << event.duration / 1000 << '.' << fmt::format("{:03}", event.duration % 1000) << '}';
+    }
+
+    file << "\n]}\n";
+
+    SPDLOG_INFO("Trace written: {} ({} events{})", path, event_count, next_event > s_capacity ? ", oldest dropped" : "");
+}
+
+uint32_t Trace::thread_index()
+{
+    thread_local uint32_t index = s_next_thread.fetch_add(1);
+
+    return index;
+}
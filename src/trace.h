@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Timeline of CPU scopes and GPU ranges, written out in the Chrome trace event format (chrome://tracing, Perfetto).
+// Events go into a fixed ring shared by all threads, recording claims a slot with a single atomic increment and the
+// oldest events are overwritten once the ring is full.
+class Trace
+{
+public:
+    enum class Track : uint32_t
+    {
+        cpu,
+        gpu,
+    };
+
+    static void enable(size_t capacity);
+    static bool is_enabled() { return s_enabled; }
+
+    // Nanoseconds since the trace was enabled.
+    static uint64_t now();
+
+    static void record(Track track, const char *name, uint64_t start, uint64_t duration);
+    static void write(const std::string &path);
+
+private:
+    struct Event
+    {
+        char name[48];
+        uint64_t start;
+        uint64_t duration;
+        uint32_t thread;
+        Track track;
+    };
+
+    static uint32_t thread_index();
+
+    static inline bool s_enabled = false;
+    static inline std::unique_ptr<Event[]> s_events;
+    static inline size_t s_capacity = 0;
+    static inline std::atomic<uint64_t> s_next_event{0};
+    static inline std::atomic<uint32_t> s_next_thread{0};
+};
+
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name) : m_name(name), m_start(Trace::is_enabled() ? Trace::now() : 0) {}
+
+    ~TraceScope()
+    {
+        if (Trace::is_enabled())
+            Trace::record(Trace::Track::cpu, m_name, m_start, Trace::now() - m_start);
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *m_name;
+    uint64_t m_start;
+};
+
+#define TRACE_CONCATENATE_IMPL(a, b) a##b
+#define TRACE_CONCATENATE(a, b) TRACE_CONCATENATE_IMPL(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCATENATE(trace_scope_, __LINE__)(name)
+#define TRACE_FUNCTION() TRACE_SCOPE(__func__)
@@ -0,0 +1,95 @@
+#include "uniform_ring.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+void UniformRing::create(MemoryAllocator &allocator, VkPhysicalDevice physical_device, VkDevice device, DescriptorSetCache &descriptor_cache,
+                         VkDeviceSize frame_size, VkDeviceSize block_size, uint32_t frame_count)
+{
+    m_allocator = &allocator;
+    m_device = device;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+
+    // Every dynamic offset has to be a multiple of the alignment, so regions and blocks are rounded up to it.
+    m_alignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 1);
+    m_block_size = block_size;
+    m_frame_size = (std::max(frame_size, block_size) + m_alignment - 1) / m_alignment * m_alignment;
+    m_frame_begin = 0;
+    m_head = 0;
+
+    if (m_block_size > properties.limits.maxUniformBufferRange)
+        throw std::runtime_error("UNIFORM_BLOCK_TOO_LARGE");
+
+    m_buffer = m_allocator->create_buffer(m_frame_size * frame_count, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    if (m_buffer.allocation.mapped == nullptr)
+        throw std::runtime_error("VULKAN_MAP_MEMORY_FAILURE");
+
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info{};
+    descriptor_set_layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    descriptor_set_layout_create_info.bindingCount = 1;
+    descriptor_set_layout_create_info.pBindings = &binding;
+
+    if (vkCreateDescriptorSetLayout(m_device, &descriptor_set_layout_create_info, nullptr, &m_set_layout) != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_CREATE_DESCRIPTOR_SET_LAYOUT_FAILURE");
+
+    // Written once, the offset bound with it picks the block.
+    m_descriptor_set = descriptor_cache.get(m_set_layout, {{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, m_buffer.buffer, 0, m_block_size}});
+}
+
+void UniformRing::destroy()
+{
+    if (m_allocator == nullptr)
+        return;
+
+    SPDLOG_INFO("Uniform ring: {} of {} bytes per frame used at most", m_high_water_mark, m_frame_size);
+
+    vkDestroyDescriptorSetLayout(m_device, m_set_layout, nullptr);
+    m_allocator->destroy_buffer(m_buffer);
+    m_allocator = nullptr;
+}
+
+void UniformRing::begin_frame(uint32_t frame)
+{
+    m_frame_begin = frame * m_frame_size;
+    m_head = m_frame_begin;
+}
+
+uint32_t UniformRing::push(const void *data, VkDeviceSize size)
+{
+    if (size > m_block_size)
+        throw std::runtime_error("UNIFORM_BLOCK_TOO_LARGE");
+
+    // The descriptor's range reaches block_size past the offset, so that much has to fit in the region.
+    if (m_head + m_block_size > m_frame_begin + m_frame_size)
+    {
+        SPDLOG_ERROR("Uniform ring is out of space ({} bytes per frame)", m_frame_size);
+        throw std::runtime_error("UNIFORM_RING_EXHAUSTED");
+    }
+
+    const VkDeviceSize offset = m_head;
+    std::memcpy(static_cast<char *>(m_buffer.allocation.mapped) + offset, data, size);
+    m_allocator->flush(m_buffer.allocation, offset, size);
+
+    m_head = (offset + size + m_alignment - 1) / m_alignment * m_alignment;
+    m_high_water_mark = std::max(m_high_water_mark, m_head - m_frame_begin);
+
+    return static_cast<uint32_t>(offset);
+}
+
+void UniformRing::bind(VkCommandBuffer command_buffer, VkPipelineLayout pipeline_layout, uint32_t set, uint32_t dynamic_offset) const
+{
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, set, 1, &m_descriptor_set, 1, &dynamic_offset);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "descriptor_allocator.h"
+#include "memory_allocator.h"
+
+// Uniform blocks sub-allocated from one persistently mapped buffer. Each frame in flight owns a region that is filled
+// front to back and rewound when the frame begins again, and the whole buffer sits behind a single dynamic uniform
+// buffer descriptor. A block therefore costs a memcpy and a dynamic offset, never a buffer or a descriptor write.
+class UniformRing
+{
+public:
+    // Blocks are at most block_size bytes, the range every dynamic offset is bound with.
+    void create(MemoryAllocator &allocator, VkPhysicalDevice physical_device, VkDevice device, DescriptorSetCache &descriptor_cache,
+                VkDeviceSize frame_size, VkDeviceSize block_size, uint32_t frame_count);
+    void destroy();
+
+    // Everything written since the frame last ran is known to be consumed once its submission has completed.
+    void begin_frame(uint32_t frame);
+
+    // Copies the block into the current frame's region and returns the dynamic offset to bind it with.
+    uint32_t push(const void *data, VkDeviceSize size);
+
+    template <typename T>
+    uint32_t push(const T &block) { return push(&block, sizeof(T)); }
+
+    void bind(VkCommandBuffer command_buffer, VkPipelineLayout pipeline_layout, uint32_t set, uint32_t dynamic_offset) const;
+
+    // Binding 0 is the dynamic uniform buffer, visible to the vertex and fragment stages.
+    VkDescriptorSetLayout set_layout() const { return m_set_layout; }
+
+private:
+    MemoryAllocator *m_allocator = nullptr;
+    VkDevice m_device = VK_NULL_HANDLE;
+    Buffer m_buffer;
+    VkDescriptorSetLayout m_set_layout = VK_NULL_HANDLE;
+    VkDescriptorSet m_descriptor_set = VK_NULL_HANDLE;
+
+    VkDeviceSize m_frame_size = 0;
+    VkDeviceSize m_block_size = 0;
+    VkDeviceSize m_alignment = 1;
+    VkDeviceSize m_frame_begin = 0;
+    VkDeviceSize m_head = 0;
+
+    VkDeviceSize m_high_water_mark = 0;
+};
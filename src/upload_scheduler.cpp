@@ -0,0 +1,243 @@
+#include "upload_scheduler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "trace.h"
+
+void UploadScheduler::create(MemoryAllocator &allocator, VkDevice device, VkQueue transfer_queue, uint32_t transfer_family_index, uint32_t graphics_family_index)
+{
+    m_allocator = &allocator;
+    m_device = device;
+    m_transfer_queue = transfer_queue;
+    m_transfer_family_index = transfer_family_index;
+    m_graphics_family_index = graphics_family_index;
+
+    VkCommandPoolCreateInfo pool_create_info{};
+    pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_create_info.queueFamilyIndex = m_transfer_family_index;
+    pool_create_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+    if (vkCreateCommandPool(m_device, &pool_create_info, nullptr, &m_command_pool) != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_CREATE_COMMAND_POOL_FAILURE");
+
+    VkSemaphoreTypeCreateInfo semaphore_type_create_info{};
+    semaphore_type_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    semaphore_type_create_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    semaphore_type_create_info.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphore_create_info{};
+    semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphore_create_info.pNext = &semaphore_type_create_info;
+
+    if (vkCreateSemaphore(m_device, &semaphore_create_info, nullptr, &m_timeline) != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_CREATE_SYNCHRONIZATION_OBJECTS_FAILURE");
+}
+
+void UploadScheduler::destroy()
+{
+    if (m_command_pool == VK_NULL_HANDLE)
+        return;
+
+    vkQueueWaitIdle(m_transfer_queue);
+
+    for (auto &batch : m_batches)
+        release_batch(*batch);
+
+    m_batches.clear();
+    m_free_batches.clear();
+
+    vkDestroySemaphore(m_device, m_timeline, nullptr);
+    m_timeline = VK_NULL_HANDLE;
+
+    vkDestroyCommandPool(m_device, m_command_pool, nullptr);
+    m_command_pool = VK_NULL_HANDLE;
+
+    SPDLOG_INFO("Upload scheduler: {:.2f} MiB uploaded on the {} queue", m_bytes_uploaded / 1048576.0, has_dedicated_queue() ? "transfer" : "graphics");
+}
+
+void UploadScheduler::upload_buffer(VkBuffer buffer, VkDeviceSize offset, const void *data, VkDeviceSize size, VkPipelineStageFlags dst_stage_mask, VkAccessFlags dst_access_mask)
+{
+    Batch &batch = recording_batch();
+
+    Buffer staging_buffer = m_allocator->create_buffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    std::memcpy(staging_buffer.allocation.mapped, data, size);
+    m_allocator->flush(staging_buffer.allocation);
+    batch.staging_buffers.push_back(staging_buffer);
+
+    VkBufferCopy region{0, offset, size};
+    vkCmdCopyBuffer(batch.command_buffer, staging_buffer.buffer, buffer, 1, &region);
+
+    // The acquire side repeats the same barrier with the graphics access mask filled in.
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = dst_access_mask;
+    barrier.srcQueueFamilyIndex = has_dedicated_queue() ? m_transfer_family_index : VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = has_dedicated_queue() ? m_graphics_family_index : VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = buffer;
+    barrier.offset = offset;
+    barrier.size = size;
+
+    batch.barriers.push_back(barrier);
+    batch.dst_stage_mask |= dst_stage_mask;
+
+    m_bytes_uploaded += size;
+}
+
+void UploadScheduler::flush()
+{
+    if (m_batches.empty() || m_batches.back()->state != BatchState::recording)
+        return;
+
+    TRACE_FUNCTION();
+
+    Batch &batch = *m_batches.back();
+
+    // Release: the destination access happens on the other queue, so this side only makes the writes available.
+    std::vector<VkBufferMemoryBarrier> release_barriers = batch.barriers;
+    for (auto &barrier : release_barriers)
+        barrier.dstAccessMask = 0;
+
+    vkCmdPipelineBarrier(batch.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                         0, nullptr, static_cast<uint32_t>(release_barriers.size()), release_barriers.data(), 0, nullptr);
+
+    if (vkEndCommandBuffer(batch.command_buffer) != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_END_COMMAND_BUFFER_FAILURE");
+
+    batch.timeline_value = m_submitted_value + 1;
+
+    VkTimelineSemaphoreSubmitInfo timeline_submit_info{};
+    timeline_submit_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timeline_submit_info.signalSemaphoreValueCount = 1;
+    timeline_submit_info.pSignalSemaphoreValues = &batch.timeline_value;
+
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.pNext = &timeline_submit_info;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &batch.command_buffer;
+    submit_info.signalSemaphoreCount = 1;
+    submit_info.pSignalSemaphores = &m_timeline;
+
+    if (vkQueueSubmit(m_transfer_queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_QUEUE_SUBMIT_FAILURE");
+
+    m_submitted_value = batch.timeline_value;
+    batch.state = BatchState::submitted;
+}
+
+void UploadScheduler::record_acquires(VkCommandBuffer command_buffer, uint64_t frame_serial, std::vector<VkSemaphore> &wait_semaphores,
+                                      std::vector<uint64_t> &wait_values, std::vector<VkPipelineStageFlags> &wait_stages)
+{
+    // Batches signal increasing values on one timeline, so a single wait on the newest covers all of them.
+    uint64_t wait_value = 0;
+    VkPipelineStageFlags wait_stage_mask = 0;
+
+    for (auto &batch : m_batches)
+    {
+        if (batch->state != BatchState::submitted)
+            continue;
+
+        for (auto &barrier : batch->barriers)
+            barrier.srcAccessMask = 0;
+
+        // The semaphore wait already orders this after the transfer, the barrier only has to make the data visible.
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, batch->dst_stage_mask, 0,
+                             0, nullptr, static_cast<uint32_t>(batch->barriers.size()), batch->barriers.data(), 0, nullptr);
+
+        wait_value = std::max(wait_value, batch->timeline_value);
+        wait_stage_mask |= batch->dst_stage_mask;
+
+        batch->state = BatchState::acquired;
+        batch->frame_serial = frame_serial;
+    }
+
+    if (wait_value == 0)
+        return;
+
+    wait_semaphores.push_back(m_timeline);
+    wait_values.push_back(wait_value);
+    wait_stages.push_back(wait_stage_mask);
+}
+
+bool UploadScheduler::has_pending_acquires() const
+{
+    for (const auto &batch : m_batches)
+        if (batch->state == BatchState::submitted)
+            return true;
+
+    return false;
+}
+
+void UploadScheduler::collect(uint64_t completed_frame_serial)
+{
+    for (size_t i = 0; i < m_batches.size();)
+    {
+        Batch &batch = *m_batches[i];
+
+        if (batch.state != BatchState::acquired || batch.frame_serial > completed_frame_serial)
+        {
+            i++;
+            continue;
+        }
+
+        release_batch(batch);
+        m_free_batches.push_back(std::move(m_batches[i]));
+        m_batches.erase(m_batches.begin() + i);
+    }
+}
+
+UploadScheduler::Batch &UploadScheduler::recording_batch()
+{
+    if (!m_batches.empty() && m_batches.back()->state == BatchState::recording)
+        return *m_batches.back();
+
+    std::unique_ptr<Batch> batch;
+
+    if (!m_free_batches.empty())
+    {
+        batch = std::move(m_free_batches.back());
+        m_free_batches.pop_back();
+    }
+    else
+        batch = std::make_unique<Batch>();
+
+    VkCommandBufferAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocate_info.commandPool = m_command_pool;
+    allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocate_info.commandBufferCount = 1;
+
+    if (vkAllocateCommandBuffers(m_device, &allocate_info, &batch->command_buffer) != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_ALLOCATE_COMMAND_BUFFERS_FAILURE");
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(batch->command_buffer, &begin_info) != VK_SUCCESS)
+        throw std::runtime_error("VULKAN_BEGIN_COMMAND_BUFFER_FAILURE");
+
+    batch->state = BatchState::recording;
+    batch->dst_stage_mask = 0;
+
+    m_batches.push_back(std::move(batch));
+
+    return *m_batches.back();
+}
+
+void UploadScheduler::release_batch(Batch &batch)
+{
+    for (auto &staging_buffer : batch.staging_buffers)
+        m_allocator->destroy_buffer(staging_buffer);
+
+    vkFreeCommandBuffers(m_device, m_command_pool, 1, &batch.command_buffer);
+
+    batch.command_buffer = VK_NULL_HANDLE;
+    batch.barriers.clear();
+    batch.staging_buffers.clear();
+}
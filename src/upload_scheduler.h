@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "memory_allocator.h"
+
+// Copies data into device local buffers on the transfer queue, so big uploads run alongside rendering instead of
+// stalling the graphics queue. Uploads are grouped into batches. Each batch releases its buffers from the transfer
+// family and signals the next value of the scheduler's timeline semaphore. The graphics side acquires them in a frame
+// that waits on that value at the stages that consume the data. Without a dedicated transfer family the same path runs
+// on the graphics queue, where the ownership barriers reduce to plain memory barriers.
+class UploadScheduler
+{
+public:
+    void create(MemoryAllocator &allocator, VkDevice device, VkQueue transfer_queue, uint32_t transfer_family_index, uint32_t graphics_family_index);
+    void destroy();
+
+    void upload_buffer(VkBuffer buffer, VkDeviceSize offset, const void *data, VkDeviceSize size, VkPipelineStageFlags dst_stage_mask, VkAccessFlags dst_access_mask);
+
+    // Submits the uploads queued since the last call.
+    void flush();
+
+    // Records the acquire half of every flushed batch into a graphics command buffer and appends the timeline wait
+    // its submission needs. frame_serial identifies that submission, see collect().
+    void record_acquires(VkCommandBuffer command_buffer, uint64_t frame_serial, std::vector<VkSemaphore> &wait_semaphores,
+                         std::vector<uint64_t> &wait_values, std::vector<VkPipelineStageFlags> &wait_stages);
+
+    // Recycles batches whose acquiring frame has completed, that frame waited on the transfer so it's done as well.
+    void collect(uint64_t completed_frame_serial);
+
+    bool has_pending_acquires() const;
+    bool has_dedicated_queue() const { return m_transfer_family_index != m_graphics_family_index; }
+    uint64_t bytes_uploaded() const { return m_bytes_uploaded; }
+
+private:
+    enum class BatchState
+    {
+        recording,
+        submitted,
+        acquired,
+    };
+
+    struct Batch
+    {
+        VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+        BatchState state = BatchState::recording;
+        uint64_t timeline_value = 0;
+        uint64_t frame_serial = 0;
+        VkPipelineStageFlags dst_stage_mask = 0;
+        std::vector<VkBufferMemoryBarrier> barriers;
+        std::vector<Buffer> staging_buffers;
+    };
+
+    Batch &recording_batch();
+    void release_batch(Batch &batch);
+
+    MemoryAllocator *m_allocator = nullptr;
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkQueue m_transfer_queue = VK_NULL_HANDLE;
+    uint32_t m_transfer_family_index = 0;
+    uint32_t m_graphics_family_index = 0;
+    VkCommandPool m_command_pool = VK_NULL_HANDLE;
+    VkSemaphore m_timeline = VK_NULL_HANDLE;
+    uint64_t m_submitted_value = 0;
+
+    std::vector<std::unique_ptr<Batch>> m_batches;
+    std::vector<std::unique_ptr<Batch>> m_free_batches;
+    uint64_t m_bytes_uploaded = 0;
+};